@@ -0,0 +1,277 @@
+#pragma once
+/*滚动文件归档：
+    1.滚动类落地方向关闭一个文件后交给Archiver，由其低优先级(nice 19)后台线程压缩为.gz，不占用日志器的工作线程
+    2.保留策略：按归档个数/总大小/保存时间删除最旧的归档(包括之前运行留下的归档)，同时删除其时间索引(.idx)
+    gzip压缩需要zlib(CMake找到zlib时定义LOG_MASTER_HAS_ZLIB并链接)，否则只执行保留策略
+    进程退出时正在压缩的文件会中止(保留原文件)，尚未开始压缩的文件保持原样*/
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#ifdef LOG_MASTER_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#include "./util.hpp"
+#include "./logindex.hpp"
+
+namespace log_master
+{
+    #define ARCHIVE_READ_SIZE 256*1024 // 压缩时每次读取的大小
+
+    enum CompressType
+    {
+        COMPRESS_NONE,
+        COMPRESS_GZIP
+    };
+
+    struct ArchivePolicy
+    {
+        CompressType _compress = COMPRESS_NONE;
+        int _level = 6;          // 压缩等级(1~9)
+        size_t _max_files = 0;   // 最多保留的归档个数(0表示不限制，下同)
+        uint64_t _max_bytes = 0; // 归档总大小上限
+        time_t _max_age = 0;     // 归档最长保存时间(秒)
+
+        static ArchivePolicy None()
+        {
+            return ArchivePolicy();
+        }
+        static ArchivePolicy Gzip(int level = 6)
+        {
+            ArchivePolicy p;
+            p._compress = COMPRESS_GZIP;
+            p._level = level;
+            return p;
+        }
+        // 设置保留策略，如ArchivePolicy::Gzip().retain(30, 10ull << 30, 7 * 24 * 3600)
+        ArchivePolicy &retain(size_t max_files, uint64_t max_bytes = 0, time_t max_age = 0)
+        {
+            _max_files = max_files;
+            _max_bytes = max_bytes;
+            _max_age = max_age;
+            return *this;
+        }
+        bool enabled() const { return _compress != COMPRESS_NONE || _max_files != 0 || _max_bytes != 0 || _max_age != 0; }
+    };
+
+    class Archiver
+    {
+    public:
+        using ptr = std::shared_ptr<Archiver>;
+        // basename与滚动类落地方向相同，用于在目录中找出之前的归档
+        Archiver(const std::string &basename, const ArchivePolicy &policy) : _policy(policy), _stop(false)
+        {
+            if (_policy._compress == COMPRESS_GZIP && !CompressAvailable())
+            {
+                std::cout << "未找到zlib，滚动文件不压缩" << std::endl;
+                _policy._compress = COMPRESS_NONE;
+            }
+            _dir = Util::File::Path(basename);
+            if (_dir == ".")
+            {
+                _dir = "./";
+            }
+            size_t pos = basename.find_last_of("/\\");
+            _prefix = pos == std::string::npos ? basename : basename.substr(pos + 1);
+            _suffix = _policy._compress == COMPRESS_GZIP ? ".log.gz" : ".log";
+            scan();
+            _thread = std::thread(&Archiver::threadEntry, this);
+        }
+        ~Archiver()
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _cond.notify_all();
+            _thread.join();
+        }
+        // 提交一个已关闭的滚动文件
+        void submit(const std::string &pathname)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _queue.push_back(pathname);
+            }
+            _cond.notify_one();
+        }
+        static bool CompressAvailable()
+        {
+#ifdef LOG_MASTER_HAS_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        }
+        // 将src压缩为gzip格式的dst，stop置位时中止；失败时删除dst
+        static bool Compress(const std::string &src, const std::string &dst, int level, const std::atomic<bool> *stop = nullptr)
+        {
+#ifdef LOG_MASTER_HAS_ZLIB
+            int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+            if (in < 0)
+            {
+                return false;
+            }
+            std::string mode = "wb" + std::to_string(std::max(1, std::min(9, level)));
+            gzFile out = gzopen(dst.c_str(), mode.c_str());
+            if (out == nullptr)
+            {
+                ::close(in);
+                return false;
+            }
+            gzbuffer(out, ARCHIVE_READ_SIZE);
+            std::vector<char> buf(ARCHIVE_READ_SIZE);
+            bool ok = true;
+            ssize_t n;
+            while ((n = read(in, &buf[0], buf.size())) > 0)
+            {
+                if ((stop != nullptr && stop->load(std::memory_order_relaxed)) || gzwrite(out, &buf[0], (unsigned)n) != (int)n)
+                {
+                    ok = false;
+                    break;
+                }
+            }
+            ok = ok && n == 0;
+            ::close(in);
+            ok = gzclose(out) == Z_OK && ok;
+            if (!ok)
+            {
+                unlink(dst.c_str());
+            }
+            return ok;
+#else
+            (void)src;
+            (void)dst;
+            (void)level;
+            (void)stop;
+            return false;
+#endif
+        }
+
+    private:
+        struct Entry
+        {
+            std::string _pathname;
+            uint64_t _size;
+            time_t _mtime;
+        };
+        // 收集目录中之前留下的归档(按修改时间从旧到新)
+        void scan()
+        {
+            DIR *d = opendir(_dir.c_str());
+            if (d == nullptr)
+            {
+                return;
+            }
+            struct dirent *e;
+            while ((e = readdir(d)) != nullptr)
+            {
+                std::string name = e->d_name;
+                if (name.size() < _prefix.size() + _suffix.size() || name.compare(0, _prefix.size(), _prefix) != 0 ||
+                    name.compare(name.size() - _suffix.size(), _suffix.size(), _suffix) != 0)
+                {
+                    continue;
+                }
+                add(_dir + name);
+            }
+            closedir(d);
+            std::sort(_archives.begin(), _archives.end(), [](const Entry &a, const Entry &b)
+                      { return a._mtime != b._mtime ? a._mtime < b._mtime : a._pathname < b._pathname; });
+        }
+        void add(const std::string &pathname)
+        {
+            struct stat st;
+            if (stat(pathname.c_str(), &st) != 0)
+            {
+                return;
+            }
+            _archives.push_back(Entry{pathname, (uint64_t)st.st_size, st.st_mtime});
+            _total += st.st_size;
+        }
+        void archive(const std::string &pathname)
+        {
+            if (_policy._compress == COMPRESS_GZIP)
+            {
+                std::string gz = pathname + ".gz";
+                if (Compress(pathname, gz, _policy._level, &_stop))
+                {
+                    unlink(pathname.c_str());
+                    add(gz);
+                    return;
+                }
+                if (_stop)
+                {
+                    return;
+                }
+                std::cout << "压缩滚动文件失败:" << pathname << std::endl;
+            }
+            add(pathname);
+        }
+        // 删除最旧的归档直到满足保留策略
+        void retain()
+        {
+            time_t now = Util::Date::getTime();
+            while (!_archives.empty() &&
+                   ((_policy._max_files != 0 && _archives.size() > _policy._max_files) ||
+                    (_policy._max_bytes != 0 && _total > _policy._max_bytes) ||
+                    (_policy._max_age != 0 && now - _archives.front()._mtime > _policy._max_age)))
+            {
+                unlink(_archives.front()._pathname.c_str());
+                unlink(LogIndex::IndexPath(_archives.front()._pathname).c_str());
+                _total -= _archives.front()._size;
+                _archives.pop_front();
+            }
+        }
+        void threadEntry()
+        {
+            // 只降低本线程的优先级(Linux上nice值按线程生效)
+            setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+            retain();
+            while (true)
+            {
+                std::string pathname;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _cond.wait(lock, [&]()
+                               { return _stop || !_queue.empty(); });
+                    if (_stop)
+                    {
+                        return;
+                    }
+                    pathname = _queue.front();
+                    _queue.pop_front();
+                }
+                archive(pathname);
+                retain();
+            }
+        }
+
+    private:
+        ArchivePolicy _policy;
+        std::string _dir;
+        std::string _prefix;
+        std::string _suffix;
+        std::deque<Entry> _archives; // 现有归档，从旧到新(仅后台线程使用)
+        uint64_t _total = 0;         // 现有归档的总大小
+        std::atomic<bool> _stop;
+        std::deque<std::string> _queue;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::thread _thread;
+    };
+}
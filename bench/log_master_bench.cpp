@@ -0,0 +1,667 @@
+/*性能测试：同步/异步日志器的吞吐量与单次调用延迟
+    用法: log_master_bench [--quick] [--messages N] [--threads 1,2,4] [--dir 临时目录] [--out 结果.json]
+    结果以JSON输出(默认标准输出)，进度信息输出到标准错误
+    每个场景输出:
+        producer_msgs_per_sec: 生产者调用阶段的吞吐量
+        total_msgs_per_sec:    包含异步日志器落地完成(日志器析构)在内的吞吐量
+        latency_ns:            单次日志调用延迟的p50/p99/p99.9/max
+    另输出滚动文件gzip压缩的吞吐量与CPU开销(archive)，以及各接口单次日志调用在调用线程上的堆分配次数(allocations，常见路径应为0)
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../bitlog.h"
+
+#ifdef __GLIBC__
+// 统计调用线程上的堆分配次数(转发给glibc的实现)
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+static thread_local uint64_t g_allocs = 0;
+extern "C" void *malloc(size_t size)
+{
+    g_allocs++;
+    return __libc_malloc(size);
+}
+extern "C" void *calloc(size_t n, size_t size)
+{
+    g_allocs++;
+    return __libc_calloc(n, size);
+}
+extern "C" void *realloc(void *p, size_t size)
+{
+    g_allocs++;
+    return __libc_realloc(p, size);
+}
+#define BENCH_COUNT_ALLOCS 1
+#else
+static uint64_t g_allocs = 0;
+#define BENCH_COUNT_ALLOCS 0
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // 空落地方向：只统计字节数，用于测量日志器自身开销
+    class NullLogSink : public log_master::LogSink
+    {
+    public:
+        void Log(const char *data, size_t len) override
+        {
+            _bytes += len;
+        }
+
+    private:
+        size_t _bytes = 0;
+    };
+
+    enum Api
+    {
+        API_PRINTF, // info("%s--%d")
+        API_FMT,    // info_fmt("{}--{}")
+        API_BIN,     // info_bin("%s--%d")，延迟格式化
+        API_DISABLED, // 日志器等级为INFO时的debug("%s--%d")，只测等级检查
+        API_KV        // info_kv("login", kv("user"), kv("id"))，结构化字段
+    };
+    enum SinkKind
+    {
+        SINK_NULL,
+        SINK_STDOUT,
+        SINK_FILE,
+        SINK_ROLL_BY_FILE,
+        SINK_ROLL_BY_TIME,
+        SINK_MMAP,
+        SINK_ROLL_GZIP // 按大小滚动，关闭的文件由后台线程gzip压缩
+    };
+    enum Io
+    {
+        IO_STREAM, // ofstream(默认)
+        IO_PWRITE, // IO_ENGINE_PWRITE
+        IO_URING   // IO_ENGINE_URING
+    };
+    enum Mode
+    {
+        MODE_SYNC,
+        MODE_SYNC_COMBINING,
+        MODE_ASYNC_SAFE,
+        MODE_ASYNC_NOSAFE,
+        MODE_RING_SAFE,
+        MODE_RING_NOSAFE,
+        MODE_SHARED_SAFE
+    };
+
+    const char *ApiName(Api api)
+    {
+        switch (api)
+        {
+        case API_PRINTF:
+            return "printf";
+        case API_FMT:
+            return "fmt";
+        case API_BIN:
+            return "bin";
+        case API_DISABLED:
+            return "disabled";
+        case API_KV:
+            return "kv";
+        }
+        return "";
+    }
+    const char *SinkName(SinkKind sink)
+    {
+        switch (sink)
+        {
+        case SINK_NULL:
+            return "null";
+        case SINK_STDOUT:
+            return "stdout";
+        case SINK_FILE:
+            return "file";
+        case SINK_ROLL_BY_FILE:
+            return "roll_by_file";
+        case SINK_ROLL_BY_TIME:
+            return "roll_by_time";
+        case SINK_MMAP:
+            return "mmap";
+        case SINK_ROLL_GZIP:
+            return "roll_by_file_gzip";
+        }
+        return "";
+    }
+    const char *IoName(Io io)
+    {
+        switch (io)
+        {
+        case IO_STREAM:
+            return "stream";
+        case IO_PWRITE:
+            return "pwrite";
+        case IO_URING:
+            return "uring";
+        }
+        return "";
+    }
+    const char *ModeName(Mode mode)
+    {
+        switch (mode)
+        {
+        case MODE_SYNC:
+            return "sync";
+        case MODE_SYNC_COMBINING:
+            return "sync_combining";
+        case MODE_ASYNC_SAFE:
+            return "async_safe";
+        case MODE_ASYNC_NOSAFE:
+            return "async_nosafe";
+        case MODE_RING_SAFE:
+            return "ring_safe";
+        case MODE_RING_NOSAFE:
+            return "ring_nosafe";
+        case MODE_SHARED_SAFE:
+            return "shared_safe";
+        }
+        return "";
+    }
+
+    struct Scenario
+    {
+        std::string group;
+        Mode mode;
+        SinkKind sink;
+        std::string pattern;
+        Api api;
+        size_t threads;
+        size_t messages;
+        Io io;
+    };
+    struct Result
+    {
+        double producer_seconds;
+        double total_seconds;
+        uint64_t p50, p99, p999, max;
+    };
+
+    std::string g_dir = "./log_master_bench_tmp/";
+
+    void CleanDir(const std::string &dir)
+    {
+        DIR *d = opendir(dir.c_str());
+        if (d == nullptr)
+        {
+            return;
+        }
+        struct dirent *e;
+        while ((e = readdir(d)) != nullptr)
+        {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+            {
+                continue;
+            }
+            unlink((dir + e->d_name).c_str());
+        }
+        closedir(d);
+    }
+
+    log_master::Logger::ptr BuildLogger(const Scenario &sc, const log_master::Durability &durability = log_master::Durability())
+    {
+        std::unique_ptr<log_master::LoggerBuilder> builder(new log_master::LocalLoggerBuilder());
+        builder->buildLoggerName("bench");
+        // "json"/"logfmt"表示结构化格式
+        if (sc.pattern == "json" || sc.pattern == "logfmt")
+        {
+            builder->buildLoggerFormatter(sc.pattern == "json" ? log_master::FORMAT_JSON : log_master::FORMAT_LOGFMT);
+        }
+        else
+        {
+            builder->buildLoggerFormatter(sc.pattern);
+        }
+        builder->buildLoggerLevel(sc.api == API_DISABLED ? log_master::Log_level::INFO : log_master::Log_level::DEBUG);
+        log_master::IoEngine::ptr io;
+        if (sc.io != IO_STREAM)
+        {
+            io = log_master::IoEngineFactory::Create(sc.io == IO_URING ? log_master::IO_ENGINE_URING : log_master::IO_ENGINE_PWRITE);
+        }
+        switch (sc.sink)
+        {
+        case SINK_NULL:
+            builder->buildLoggerSinks<NullLogSink>();
+            break;
+        case SINK_STDOUT:
+            builder->buildLoggerSinks<log_master::StdoutLogSink>();
+            break;
+        case SINK_FILE:
+            builder->buildLoggerSinks<log_master::FileLogSink>(g_dir + "file.log", io);
+            break;
+        case SINK_ROLL_BY_FILE:
+            builder->buildLoggerSinks<log_master::RollByFileLogSink>(g_dir + "rollf-", 64 * 1024 * 1024, io);
+            break;
+        case SINK_ROLL_BY_TIME:
+            builder->buildLoggerSinks<log_master::RollByTimeLogSink>(g_dir + "rollt-", log_master::RollByTimeLogSink::GAP_MINUTE, io);
+            break;
+        case SINK_MMAP:
+            builder->buildLoggerSinks<log_master::MmapFileLogSink>(g_dir + "mmap-", 64 * 1024 * 1024);
+            break;
+        case SINK_ROLL_GZIP:
+            builder->buildLoggerSinks<log_master::RollByFileLogSink>(g_dir + "rollz-", 16 * 1024 * 1024, io, log_master::ArchivePolicy::Gzip(1));
+            break;
+        }
+        builder->buildSinkDurability(durability);
+        if (sc.mode == MODE_SYNC_COMBINING)
+        {
+            builder->buildEnableSyncCombining();
+        }
+        else if (sc.mode != MODE_SYNC)
+        {
+            builder->buildLoggerType(log_master::LOGGER_ASYNC);
+            if (sc.mode == MODE_RING_SAFE || sc.mode == MODE_RING_NOSAFE)
+            {
+                builder->buildLooperEngine(log_master::LOOPER_RING);
+            }
+            if (sc.mode == MODE_SHARED_SAFE)
+            {
+                builder->buildLooperEngine(log_master::LOOPER_SHARED);
+            }
+            if (sc.mode == MODE_ASYNC_NOSAFE || sc.mode == MODE_RING_NOSAFE)
+            {
+                builder->buileEnableUnSafeAsync();
+            }
+            if (sc.api == API_BIN)
+            {
+                builder->buildEnableDeferredAsync();
+            }
+        }
+        return builder->build();
+    }
+
+    void Producer(log_master::Logger::ptr logger, Api api, size_t count, uint32_t *lat)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Clock::time_point t0 = Clock::now();
+            switch (api)
+            {
+            case API_PRINTF:
+                logger->info("%s--%d", "INFO", (int)i);
+                break;
+            case API_FMT:
+                logger->info_fmt("{}--{}", "INFO", i);
+                break;
+            case API_BIN:
+                logger->info_bin("%s--%d", "INFO", (int)i);
+                break;
+            case API_DISABLED:
+                logger->debug("%s--%d", "DEBUG", (int)i);
+                break;
+            case API_KV:
+                logger->info_kv("login", log_master::kv("user", "INFO"), log_master::kv("id", i));
+                break;
+            }
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+            lat[i] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+        }
+    }
+
+    // 等待日志全部写入落地方向并刷盘(异步缓冲区为空、写入字节数不再变化且没有未刷盘的字节)，返回等待的毫秒数
+    double WaitCommitted(log_master::Logger::ptr logger)
+    {
+        Clock::time_point begin = Clock::now();
+        uint64_t last = UINT64_MAX;
+        while (Clock::now() - begin < std::chrono::seconds(1))
+        {
+            log_master::LoggerStats st = logger->stats();
+            uint64_t bytes = st._sinks[0]._bytes;
+            if (st._looper._fill == 0 && bytes == last && st._sinks[0]._unsynced_bytes == 0)
+            {
+                return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+            }
+            last = bytes;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return -1;
+    }
+
+    // syncs非空时在生产者结束后调用Logger::flush()(计入总时间)，并返回落地方向的刷盘次数；
+    //  tail_ms非空时(按间隔刷盘)不调用flush()，等待定时器把末尾的日志刷盘，返回生产者结束到全部刷盘的毫秒数(1秒内未刷盘为-1)
+    Result Run(const Scenario &sc, const log_master::Durability &durability = log_master::Durability(), uint64_t *syncs = nullptr,
+               double *tail_ms = nullptr)
+    {
+        CleanDir(g_dir);
+        size_t per_thread = sc.messages / sc.threads;
+        std::vector<uint32_t> lat(per_thread * sc.threads);
+        Result res;
+        Clock::time_point begin, produced, end;
+        {
+            log_master::Logger::ptr logger = BuildLogger(sc, durability);
+            std::vector<std::thread> threads;
+            begin = Clock::now();
+            for (size_t t = 0; t < sc.threads; t++)
+            {
+                threads.emplace_back(Producer, logger, sc.api, per_thread, &lat[t * per_thread]);
+            }
+            for (auto &t : threads)
+            {
+                t.join();
+            }
+            produced = Clock::now();
+            if (tail_ms != nullptr)
+            {
+                *tail_ms = WaitCommitted(logger);
+            }
+            else if (syncs != nullptr)
+            {
+                logger->flush();
+            }
+            if (syncs != nullptr)
+            {
+                *syncs = logger->stats()._sinks[0]._syncs;
+            }
+            // 日志器析构时等待异步缓冲区全部落地
+        }
+        end = Clock::now();
+        res.producer_seconds = std::chrono::duration<double>(produced - begin).count();
+        res.total_seconds = std::chrono::duration<double>(end - begin).count();
+        std::sort(lat.begin(), lat.end());
+        size_t n = lat.size();
+        res.p50 = lat[n * 50 / 100];
+        res.p99 = lat[std::min(n - 1, n * 99 / 100)];
+        res.p999 = lat[std::min(n - 1, n * 999 / 1000)];
+        res.max = lat[n - 1];
+        CleanDir(g_dir);
+        return res;
+    }
+
+    struct ArchiveResult
+    {
+        uint64_t input_bytes;
+        uint64_t output_bytes;
+        double seconds;
+        double cpu_seconds;
+    };
+    double ThreadCpuSeconds()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+    // 预热后统计单次日志调用在调用线程上的平均堆分配次数(异步日志器的后台线程不计入)
+    double RunAllocs(const Scenario &sc)
+    {
+        CleanDir(g_dir);
+        log_master::Logger::ptr logger = BuildLogger(sc);
+        std::vector<uint32_t> lat(sc.messages);
+        Producer(logger, sc.api, std::min(sc.messages, (size_t)1000), &lat[0]);
+        uint64_t before = g_allocs;
+        Producer(logger, sc.api, sc.messages, &lat[0]);
+        return (double)(g_allocs - before) / sc.messages;
+    }
+    // 压缩一个由默认格式日志组成的文件(在本线程中执行，CPU时间即压缩开销)
+    ArchiveResult RunArchive(size_t messages, int level)
+    {
+        CleanDir(g_dir);
+        std::string src = g_dir + "archive.log";
+        {
+            log_master::Formatter formatter;
+            std::string text;
+            std::ofstream ofs(src, std::ios::binary);
+            for (size_t i = 0; i < messages; i++)
+            {
+                std::string payload = "INFO--" + std::to_string(i);
+                log_master::Message::LogMsg msg(log_master::Log_level::INFO, __LINE__, __FILE__, "bench", payload);
+                formatter.Format(text, msg);
+                if (text.size() >= 1024 * 1024)
+                {
+                    ofs.write(text.data(), text.size());
+                    text.clear();
+                }
+            }
+            ofs.write(text.data(), text.size());
+        }
+        ArchiveResult res;
+        struct stat st;
+        stat(src.c_str(), &st);
+        res.input_bytes = st.st_size;
+        double cpu = ThreadCpuSeconds();
+        Clock::time_point begin = Clock::now();
+        log_master::Archiver::Compress(src, src + ".gz", level);
+        res.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        res.cpu_seconds = ThreadCpuSeconds() - cpu;
+        res.output_bytes = stat((src + ".gz").c_str(), &st) == 0 ? st.st_size : 0;
+        CleanDir(g_dir);
+        return res;
+    }
+
+    std::vector<size_t> ParseList(const std::string &str)
+    {
+        std::vector<size_t> list;
+        std::stringstream ss(str);
+        std::string item;
+        while (std::getline(ss, item, ','))
+        {
+            list.push_back(strtoul(item.c_str(), nullptr, 10));
+        }
+        return list;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t messages = 1000000;
+    std::vector<size_t> threads = {1, 2, 4, 8, 16, 32, 64};
+    std::string out_path;
+    bool with_stdout = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--quick")
+        {
+            messages = 100000;
+            threads = {1, 4, 16, 64};
+        }
+        else if (arg == "--messages" && i + 1 < argc)
+        {
+            messages = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = ParseList(argv[++i]);
+        }
+        else if (arg == "--dir" && i + 1 < argc)
+        {
+            g_dir = argv[++i];
+            if (g_dir.back() != '/')
+            {
+                g_dir += '/';
+            }
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            out_path = argv[++i];
+        }
+        else if (arg == "--with-stdout")
+        {
+            with_stdout = true;
+        }
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--quick] [--messages N] [--threads 1,2,4] [--dir DIR] [--out FILE] [--with-stdout]" << std::endl;
+            return 1;
+        }
+    }
+    log_master::Util::File::CreateDirectory(g_dir);
+
+    const std::string default_pattern = DEFAULT_FORMAT_PATTERN;
+    std::vector<Scenario> scenarios;
+    // 1.线程数 x 日志器模式(文件落地，默认格式)
+    const Mode modes[] = {MODE_SYNC, MODE_SYNC_COMBINING, MODE_ASYNC_SAFE, MODE_ASYNC_NOSAFE, MODE_RING_SAFE, MODE_RING_NOSAFE, MODE_SHARED_SAFE};
+    for (size_t t : threads)
+    {
+        for (Mode mode : modes)
+        {
+            scenarios.push_back(Scenario{"threads", mode, SINK_FILE, default_pattern, API_PRINTF, t, messages, IO_STREAM});
+        }
+    }
+    // 2.落地方向(异步安全模式，4线程)
+    std::vector<SinkKind> sinks = {SINK_NULL, SINK_FILE, SINK_ROLL_BY_FILE, SINK_ROLL_BY_TIME, SINK_MMAP};
+    if (log_master::Archiver::CompressAvailable())
+    {
+        sinks.push_back(SINK_ROLL_GZIP);
+    }
+    if (with_stdout)
+    {
+        sinks.push_back(SINK_STDOUT);
+    }
+    for (SinkKind sink : sinks)
+    {
+        scenarios.push_back(Scenario{"sinks", MODE_ASYNC_SAFE, sink, default_pattern, API_PRINTF, 4, messages, IO_STREAM});
+    }
+    // 3.格式化规则(空落地方向，单线程同步，只测格式化开销)
+    const char *patterns[] = {"%m%n", DEFAULT_FORMAT_PATTERN, "%d{%Y-%m-%d %H:%M:%S.%6N} %p %c %f:%l %m%n"};
+    for (const char *pattern : patterns)
+    {
+        scenarios.push_back(Scenario{"patterns", MODE_SYNC, SINK_NULL, pattern, API_PRINTF, 1, messages, IO_STREAM});
+    }
+    // 结构化格式(带字段的日志)
+    const char *structured[] = {"json", "logfmt"};
+    for (const char *pattern : structured)
+    {
+        scenarios.push_back(Scenario{"patterns", MODE_SYNC, SINK_NULL, pattern, API_KV, 1, messages, IO_STREAM});
+    }
+    // 4.调用接口(空落地方向，单线程无锁异步)
+    const Api apis[] = {API_PRINTF, API_FMT, API_BIN, API_DISABLED, API_KV};
+    for (Api api : apis)
+    {
+        scenarios.push_back(Scenario{"apis", MODE_RING_SAFE, SINK_NULL, default_pattern, api, 1, messages, IO_STREAM});
+    }
+
+    // 5.文件写入引擎(文件落地，4线程)
+    const Io ios[] = {IO_STREAM, IO_PWRITE, IO_URING};
+    const Mode io_modes[] = {MODE_ASYNC_SAFE, MODE_RING_SAFE};
+    for (Mode mode : io_modes)
+    {
+        for (Io io : ios)
+        {
+            scenarios.push_back(Scenario{"io", mode, SINK_FILE, default_pattern, API_PRINTF, 4, messages, io});
+        }
+    }
+
+    std::stringstream json;
+    json << "{\n  \"messages_per_scenario\": " << messages << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < scenarios.size(); i++)
+    {
+        const Scenario &sc = scenarios[i];
+        std::cerr << "[" << i + 1 << "/" << scenarios.size() << "] " << sc.group << " " << ModeName(sc.mode) << " " << SinkName(sc.sink)
+                  << " " << ApiName(sc.api) << " " << IoName(sc.io) << " threads=" << sc.threads << std::endl;
+        Result r = Run(sc);
+        size_t total = sc.messages / sc.threads * sc.threads;
+        json << "    {\"group\": \"" << sc.group << "\", \"mode\": \"" << ModeName(sc.mode) << "\", \"sink\": \"" << SinkName(sc.sink)
+             << "\", \"api\": \"" << ApiName(sc.api) << "\", \"io\": \"" << IoName(sc.io) << "\", \"pattern\": \"" << sc.pattern << "\", \"threads\": " << sc.threads
+             << ", \"messages\": " << total
+             << ", \"producer_msgs_per_sec\": " << (uint64_t)(total / r.producer_seconds)
+             << ", \"total_msgs_per_sec\": " << (uint64_t)(total / r.total_seconds)
+             << ", \"latency_ns\": {\"p50\": " << r.p50 << ", \"p99\": " << r.p99 << ", \"p999\": " << r.p999 << ", \"max\": " << r.max << "}}"
+             << (i + 1 == scenarios.size() ? "\n" : ",\n");
+    }
+    json << "  ],\n  \"archive\": [";
+    // 6.滚动文件压缩(gzip等级1/6)
+    if (log_master::Archiver::CompressAvailable())
+    {
+        const int levels[] = {1, 6};
+        for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++)
+        {
+            std::cerr << "[archive] gzip level=" << levels[i] << std::endl;
+            ArchiveResult r = RunArchive(messages, levels[i]);
+            double mb = r.input_bytes / (1024.0 * 1024.0);
+            json << (i == 0 ? "\n" : ",\n") << "    {\"compress\": \"gzip\", \"level\": " << levels[i]
+                 << ", \"input_bytes\": " << r.input_bytes << ", \"output_bytes\": " << r.output_bytes
+                 << ", \"ratio\": " << (r.output_bytes ? (double)r.input_bytes / r.output_bytes : 0)
+                 << ", \"input_mb_per_sec\": " << mb / r.seconds
+                 << ", \"cpu_seconds\": " << r.cpu_seconds << ", \"cpu_ms_per_mb\": " << r.cpu_seconds * 1000 / mb << "}";
+        }
+        json << "\n  ";
+    }
+    json << "],\n  \"allocations\": [";
+    // 7.调用线程上的堆分配(空落地方向)
+    if (BENCH_COUNT_ALLOCS)
+    {
+        const Mode alloc_modes[] = {MODE_SYNC, MODE_ASYNC_SAFE, MODE_RING_SAFE};
+        const Api alloc_apis[] = {API_PRINTF, API_FMT, API_BIN, API_KV};
+        bool first = true;
+        for (Mode mode : alloc_modes)
+        {
+            for (Api api : alloc_apis)
+            {
+                std::cerr << "[allocations] " << ModeName(mode) << " " << ApiName(api) << std::endl;
+                Scenario sc{"allocations", mode, SINK_NULL, default_pattern, api, 1, std::min(messages, (size_t)100000), IO_STREAM};
+                double allocs = RunAllocs(sc);
+                json << (first ? "\n" : ",\n") << "    {\"mode\": \"" << ModeName(mode) << "\", \"api\": \"" << ApiName(api)
+                     << "\", \"calls\": " << sc.messages << ", \"allocs_per_call\": " << allocs << "}";
+                first = false;
+            }
+        }
+        json << "\n  ";
+    }
+    json << "],\n  \"durability\": [";
+    // 8.持久化策略(文件落地，4线程；结束时调用flush()，总吞吐量包含最后一次刷盘；
+    //   interval_10ms不调用flush()，tail_commit_ms为生产者结束后由定时器把末尾日志刷盘所用的时间)
+    {
+        const Mode durable_modes[] = {MODE_SYNC, MODE_SYNC_COMBINING, MODE_ASYNC_SAFE};
+        const char *names[] = {"none", "interval_10ms", "batch", "sync"};
+        const log_master::Durability levels[] = {log_master::Durability::None(), log_master::Durability::Interval(10),
+                                                 log_master::Durability::EveryBatch(), log_master::Durability::Sync()};
+        bool first = true;
+        for (Mode mode : durable_modes)
+        {
+            for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++)
+            {
+                std::cerr << "[durability] " << ModeName(mode) << " " << names[i] << std::endl;
+                // 逐条刷盘的组合每条日志一次fsync，减少条数
+                size_t count = std::min(messages, (size_t)(levels[i]._level >= log_master::DURABILITY_BATCH ? 20000 : 100000));
+                Scenario sc{"durability", mode, SINK_FILE, default_pattern, API_PRINTF, 4, count, IO_STREAM};
+                uint64_t syncs = 0;
+                double tail_ms = 0;
+                bool interval = levels[i]._level == log_master::DURABILITY_INTERVAL;
+                Result r = Run(sc, levels[i], &syncs, interval ? &tail_ms : nullptr);
+                size_t total = sc.messages / sc.threads * sc.threads;
+                json << (first ? "\n" : ",\n") << "    {\"mode\": \"" << ModeName(mode) << "\", \"durability\": \"" << names[i]
+                     << "\", \"threads\": " << sc.threads << ", \"messages\": " << total << ", \"syncs\": " << syncs
+                     << ", \"producer_msgs_per_sec\": " << (uint64_t)(total / r.producer_seconds)
+                     << ", \"total_msgs_per_sec\": " << (uint64_t)(total / r.total_seconds)
+                     << ", \"latency_ns\": {\"p50\": " << r.p50 << ", \"p99\": " << r.p99 << ", \"max\": " << r.max << "}";
+                if (interval)
+                {
+                    json << ", \"tail_commit_ms\": " << tail_ms;
+                }
+                json << "}";
+                first = false;
+            }
+        }
+        json << "\n  ";
+    }
+    json << "]\n}\n";
+    if (out_path.empty())
+    {
+        std::cout << json.str();
+    }
+    else
+    {
+        std::ofstream ofs(out_path);
+        ofs << json.str();
+    }
+    rmdir(g_dir.c_str());
+    return 0;
+}
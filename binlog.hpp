@@ -0,0 +1,575 @@
+#pragma once
+/*延迟格式化的二进制日志
+    1.调用点在首次执行时注册为静态的CallSite(文件、行号、等级、printf格式串)，得到全局唯一id
+    2.生产者只写入 [调用点id + 时间 + 线程ID + 原始参数字节]，不做任何格式化
+    3.后台线程(Decoder)或离线工具(log_master_decode)按调用点的格式串还原出LogMsg再交给Formatter
+    帧格式(本机字节序): [uint32 帧总长][uint32 帧类型][帧内容]
+        FRAME_RECORD: uint32 调用点id, uint32 参数个数, uint64 时间(纳秒), uint64 线程ID, 参数序列([uint8 类型][数据])
+        FRAME_TEXT:   已格式化好的文本(同一日志器中printf/{}风格接口的输出)
+        FRAME_SITE:   uint32 调用点id, uint32 等级, uint64 行号, uint32 文件名长度, uint32 格式串长度, 文件名, 格式串
+        FRAME_NAME:   日志器名称
+        FRAME_MSG:    uint32 等级, uint32 文件名长度, uint32 结构化字段长度, uint32 保留, uint64 行号, uint64 时间(纳秒), uint64 线程ID,
+                      文件名, 结构化字段, 有效载荷
+                      (已构造好的LogMsg，落地方向的等级或格式不同时交给后台线程按落地方向格式化)
+*/
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdarg>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <functional>
+#include <memory>
+#include <cassert>
+#include <algorithm>
+#include <unordered_map>
+
+#include "./log_level.hpp"
+#include "./message.hpp"
+#include "./fmtstr.hpp"
+
+namespace log_master
+{
+    namespace BinLog
+    {
+        #define BINLOG_FILE_MAGIC "LMBIN001"
+        enum FrameType
+        {
+            FRAME_RECORD = 1,
+            FRAME_TEXT,
+            FRAME_SITE,
+            FRAME_NAME,
+            FRAME_MSG
+        };
+        enum ArgTag
+        {
+            TAG_INT = 1,
+            TAG_UINT,
+            TAG_DOUBLE,
+            TAG_STR,
+            TAG_PTR
+        };
+        static const size_t FRAME_HEADER_SIZE = 8;
+        static const size_t RECORD_HEADER_SIZE = FRAME_HEADER_SIZE + 24;
+
+        struct CallSite;
+        // 调用点注册表：分块的原子指针表，注册加锁，查找无锁
+        class Registry
+        {
+        public:
+            static Registry &getInstance()
+            {
+                static Registry eton;
+                return eton;
+            }
+            uint32_t add(const CallSite *site)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                uint32_t id = _count;
+                size_t chunk = id / CHUNK_SIZE;
+                assert(chunk < CHUNK_COUNT);
+                if (_chunks[chunk].load(std::memory_order_relaxed) == nullptr)
+                {
+                    _chunks[chunk].store(new std::atomic<const CallSite *>[CHUNK_SIZE](), std::memory_order_release);
+                }
+                _chunks[chunk].load(std::memory_order_relaxed)[id % CHUNK_SIZE].store(site, std::memory_order_release);
+                _count++;
+                return id;
+            }
+            const CallSite *find(uint32_t id)
+            {
+                size_t chunk = id / CHUNK_SIZE;
+                if (chunk >= CHUNK_COUNT)
+                {
+                    return nullptr;
+                }
+                std::atomic<const CallSite *> *sites = _chunks[chunk].load(std::memory_order_acquire);
+                if (sites == nullptr)
+                {
+                    return nullptr;
+                }
+                return sites[id % CHUNK_SIZE].load(std::memory_order_acquire);
+            }
+
+        private:
+            Registry() : _count(0)
+            {
+                for (size_t i = 0; i < CHUNK_COUNT; i++)
+                {
+                    _chunks[i].store(nullptr);
+                }
+            }
+            static const size_t CHUNK_SIZE = 1024;
+            static const size_t CHUNK_COUNT = 1024;
+
+        private:
+            std::mutex _mutex;
+            uint32_t _count;
+            std::atomic<std::atomic<const CallSite *> *> _chunks[CHUNK_COUNT];
+        };
+
+        struct CallSite
+        {
+            uint32_t _id;
+            Log_level::level _level;
+            size_t _line;
+            const char *_file;
+            const char *_fmt; // printf风格格式串
+
+            CallSite(Log_level::level level, const char *file, size_t line, const char *fmt) : _level(level), _line(line), _file(file), _fmt(fmt)
+            {
+                _id = Registry::getInstance().add(this);
+            }
+            // 不注册，用于离线还原
+            CallSite(uint32_t id, Log_level::level level, const char *file, size_t line, const char *fmt) : _id(id), _level(level), _line(line), _file(file), _fmt(fmt) {}
+        };
+
+        // 从日志文件中读出的调用点(自行持有字符串)
+        struct StoredSite
+        {
+            std::string _file;
+            std::string _fmt;
+            CallSite _site;
+            StoredSite(uint32_t id, Log_level::level level, size_t line, const std::string &file, const std::string &fmt)
+                : _file(file), _fmt(fmt), _site(id, level, _file.c_str(), line, _fmt.c_str()) {}
+        };
+
+        // 参数编码(与FmtStr::WriteArg的重载方式一致)
+        inline void PutTag(FmtStr::Writer &w, ArgTag tag)
+        {
+            w.push((char)tag);
+        }
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type EncodeArg(FmtStr::Writer &w, T v)
+        {
+            int64_t x = v;
+            PutTag(w, TAG_INT);
+            w.append((const char *)&x, sizeof(x));
+        }
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type EncodeArg(FmtStr::Writer &w, T v)
+        {
+            uint64_t x = v;
+            PutTag(w, TAG_UINT);
+            w.append((const char *)&x, sizeof(x));
+        }
+        template <typename T>
+        typename std::enable_if<std::is_enum<T>::value>::type EncodeArg(FmtStr::Writer &w, T v)
+        {
+            EncodeArg(w, (typename std::underlying_type<T>::type)v);
+        }
+        inline void EncodeArg(FmtStr::Writer &w, double v)
+        {
+            PutTag(w, TAG_DOUBLE);
+            w.append((const char *)&v, sizeof(v));
+        }
+        inline void EncodeStr(FmtStr::Writer &w, const char *s, size_t len)
+        {
+            uint32_t n = (uint32_t)len;
+            PutTag(w, TAG_STR);
+            w.append((const char *)&n, sizeof(n));
+            w.append(s, len);
+        }
+        inline void EncodeArg(FmtStr::Writer &w, const char *s)
+        {
+            if (s == nullptr)
+            {
+                s = "(null)";
+            }
+            EncodeStr(w, s, strlen(s));
+        }
+        inline void EncodeArg(FmtStr::Writer &w, const std::string &s)
+        {
+            EncodeStr(w, s.data(), s.size());
+        }
+        inline void EncodeArg(FmtStr::Writer &w, const void *p)
+        {
+            uint64_t x = (uint64_t)(uintptr_t)p;
+            PutTag(w, TAG_PTR);
+            w.append((const char *)&x, sizeof(x));
+        }
+        inline void EncodeArgs(FmtStr::Writer &)
+        {
+        }
+        template <typename T, typename... Rest>
+        void EncodeArgs(FmtStr::Writer &w, const T &arg, const Rest &...rest)
+        {
+            EncodeArg(w, arg);
+            EncodeArgs(w, rest...);
+        }
+        inline void BeginFrame(FmtStr::Writer &w, FrameType type)
+        {
+            uint32_t head[2] = {0, (uint32_t)type};
+            w.append((const char *)head, sizeof(head));
+        }
+        inline void EndFrame(FmtStr::Writer &w, size_t begin)
+        {
+            uint32_t size = (uint32_t)(w.size() - begin);
+            w.overwrite(begin, &size, sizeof(size));
+        }
+        // 生产者：编码一条日志记录
+        template <typename... Args>
+        void EncodeRecord(FmtStr::Writer &w, const CallSite &site, uint64_t ns, const Args &...args)
+        {
+            size_t begin = w.size();
+            BeginFrame(w, FRAME_RECORD);
+            uint32_t ids[2] = {site._id, (uint32_t)sizeof...(Args)};
+            w.append((const char *)ids, sizeof(ids));
+            w.append((const char *)&ns, sizeof(ns));
+            uint64_t tid = 0;
+            std::thread::id self = std::this_thread::get_id();
+            memcpy(&tid, &self, std::min(sizeof(tid), sizeof(self)));
+            w.append((const char *)&tid, sizeof(tid));
+            EncodeArgs(w, args...);
+            EndFrame(w, begin);
+        }
+        inline void EncodeText(FmtStr::Writer &w, FrameType type, const char *data, size_t len)
+        {
+            size_t begin = w.size();
+            BeginFrame(w, type);
+            w.append(data, len);
+            EndFrame(w, begin);
+        }
+        inline void EncodeMsg(FmtStr::Writer &w, const Message::LogMsg &msg)
+        {
+            size_t begin = w.size();
+            BeginFrame(w, FRAME_MSG);
+            uint32_t head[4] = {(uint32_t)msg._level, (uint32_t)msg._file.size(), (uint32_t)msg._fields.size(), 0};
+            w.append((const char *)head, sizeof(head));
+            uint64_t vals[3] = {(uint64_t)msg._line, (uint64_t)msg._ctime * 1000000000ull + msg._nsec, 0};
+            memcpy(&vals[2], &msg._tid, std::min(sizeof(vals[2]), sizeof(msg._tid)));
+            w.append((const char *)vals, sizeof(vals));
+            w.append(msg._file.data(), msg._file.size());
+            w.append(msg._fields.data(), msg._fields.size());
+            w.append(msg._payload.data(), msg._payload.size());
+            EndFrame(w, begin);
+        }
+        inline void EncodeSite(FmtStr::Writer &w, const CallSite &site)
+        {
+            size_t begin = w.size();
+            BeginFrame(w, FRAME_SITE);
+            uint32_t head[2] = {site._id, (uint32_t)site._level};
+            w.append((const char *)head, sizeof(head));
+            uint64_t line = site._line;
+            w.append((const char *)&line, sizeof(line));
+            uint32_t lens[2] = {(uint32_t)strlen(site._file), (uint32_t)strlen(site._fmt)};
+            w.append((const char *)lens, sizeof(lens));
+            w.append(site._file, lens[0]);
+            w.append(site._fmt, lens[1]);
+            EndFrame(w, begin);
+        }
+
+        // 解码出的参数
+        struct Arg
+        {
+            int _tag;
+            uint64_t _bits;
+            const char *_str;
+            uint32_t _len;
+        };
+        class ArgReader
+        {
+        public:
+            ArgReader(const char *begin, const char *end) : _cur(begin), _end(end) {}
+            bool next(Arg &arg)
+            {
+                if (_cur >= _end)
+                {
+                    return false;
+                }
+                arg._tag = (unsigned char)*_cur++;
+                if (arg._tag == TAG_STR)
+                {
+                    if (_end - _cur < 4)
+                    {
+                        return false;
+                    }
+                    memcpy(&arg._len, _cur, 4);
+                    _cur += 4;
+                    if ((size_t)(_end - _cur) < arg._len)
+                    {
+                        return false;
+                    }
+                    arg._str = _cur;
+                    _cur += arg._len;
+                    return true;
+                }
+                if (_end - _cur < 8)
+                {
+                    return false;
+                }
+                memcpy(&arg._bits, _cur, 8);
+                _cur += 8;
+                return true;
+            }
+
+        private:
+            const char *_cur;
+            const char *_end;
+        };
+
+        // 按spec格式化后直接追加到out(先取得长度，不受临时缓冲区大小限制)
+        inline void AppendFormat(std::string &out, const char *spec, ...)
+        {
+            va_list ap, copy;
+            va_start(ap, spec);
+            va_copy(copy, ap);
+            int len = vsnprintf(nullptr, 0, spec, copy);
+            va_end(copy);
+            if (len > 0)
+            {
+                size_t old = out.size();
+                out.resize(old + len + 1);
+                vsnprintf(&out[old], len + 1, spec, ap);
+                out.resize(old + len);
+            }
+            va_end(ap);
+        }
+
+        // 按printf格式串与编码参数还原出有效载荷，长度修饰符按参数实际类型重写；
+        //  '*'宽度/精度从参数中依次取出后写入格式说明
+        inline void Printf(std::string &out, const char *fmt, ArgReader &reader)
+        {
+            std::string spec;
+            while (*fmt != '\0')
+            {
+                const char *pct = strchr(fmt, '%');
+                if (pct == nullptr)
+                {
+                    out.append(fmt);
+                    return;
+                }
+                out.append(fmt, pct - fmt);
+                fmt = pct + 1;
+                if (*fmt == '%')
+                {
+                    out.push_back('%');
+                    fmt++;
+                    continue;
+                }
+                // 标志、宽度、精度
+                spec.assign(1, '%');
+                bool missing = false;
+                while (*fmt != '\0' && strchr("-+ #0123456789.*", *fmt) != nullptr)
+                {
+                    if (*fmt != '*')
+                    {
+                        spec.push_back(*fmt++);
+                        continue;
+                    }
+                    fmt++;
+                    Arg width;
+                    if (!reader.next(width) || width._tag == TAG_STR || width._tag == TAG_DOUBLE)
+                    {
+                        missing = true;
+                        continue;
+                    }
+                    long long v = (long long)width._bits;
+                    if (v < 0 && spec.back() == '.')
+                    {
+                        spec.pop_back(); // 负的精度视为未指定
+                        continue;
+                    }
+                    spec.append(std::to_string(v)); // 负的宽度即左对齐
+                }
+                // 丢弃原有长度修饰符
+                while (*fmt != '\0' && strchr("hlLqjzt", *fmt) != nullptr)
+                {
+                    fmt++;
+                }
+                char conv = *fmt;
+                if (conv == '\0')
+                {
+                    return;
+                }
+                fmt++;
+                Arg arg;
+                if (missing || !reader.next(arg))
+                {
+                    out.append("<?>");
+                    continue;
+                }
+                if (arg._tag == TAG_STR)
+                {
+                    if (spec.size() == 1 && conv == 's')
+                    {
+                        out.append(arg._str, arg._len);
+                        continue;
+                    }
+                    std::string str(arg._str, arg._len);
+                    spec.push_back('s');
+                    AppendFormat(out, spec.c_str(), str.c_str());
+                }
+                else if (arg._tag == TAG_DOUBLE)
+                {
+                    double d;
+                    memcpy(&d, &arg._bits, sizeof(d));
+                    spec.push_back(strchr("eEfFgGaA", conv) ? conv : 'g');
+                    AppendFormat(out, spec.c_str(), d);
+                }
+                else if (arg._tag == TAG_PTR || conv == 'p')
+                {
+                    spec.push_back('p');
+                    AppendFormat(out, spec.c_str(), (void *)(uintptr_t)arg._bits);
+                }
+                else if (conv == 'c')
+                {
+                    spec.push_back('c');
+                    AppendFormat(out, spec.c_str(), (int)arg._bits);
+                }
+                else
+                {
+                    spec.append("ll");
+                    spec.push_back(strchr("diouxX", conv) ? conv : (arg._tag == TAG_INT ? 'd' : 'u'));
+                    AppendFormat(out, spec.c_str(), (long long)arg._bits);
+                }
+            }
+        }
+
+        // 帧解码器：后台线程与离线工具共用
+        class Decoder
+        {
+        public:
+            using SiteFinder = std::function<const CallSite *(uint32_t)>;
+            using MsgHandler = std::function<void(Message::LogMsg &)>;
+            using TextHandler = std::function<void(const char *, size_t)>;
+            Decoder(const std::string &name, const SiteFinder &finder = FindRegistered) : _name(name), _finder(finder) {}
+            // 复用解码器时切换日志器名称(FRAME_NAME帧同样会改变名称)
+            void setName(const std::string &name) { _name.assign(name); }
+            // 进程内解码时的调用点查找
+            static const CallSite *FindRegistered(uint32_t id)
+            {
+                return Registry::getInstance().find(id);
+            }
+            // 解码data中的完整帧，返回已消费的字节数(不完整的尾部帧留待下次)
+            size_t Decode(const char *data, size_t len, const MsgHandler &on_msg, const TextHandler &on_text)
+            {
+                size_t pos = 0;
+                while (len - pos >= FRAME_HEADER_SIZE)
+                {
+                    uint32_t head[2];
+                    memcpy(head, data + pos, sizeof(head));
+                    if (head[0] < FRAME_HEADER_SIZE || head[0] > len - pos)
+                    {
+                        break;
+                    }
+                    const char *body = data + pos + FRAME_HEADER_SIZE;
+                    size_t body_len = head[0] - FRAME_HEADER_SIZE;
+                    switch (head[1])
+                    {
+                    case FRAME_RECORD:
+                        decodeRecord(body, body_len, on_msg);
+                        break;
+                    case FRAME_TEXT:
+                        on_text(body, body_len);
+                        break;
+                    case FRAME_NAME:
+                        _name.assign(body, body_len);
+                        break;
+                    case FRAME_SITE:
+                        decodeSite(body, body_len);
+                        break;
+                    case FRAME_MSG:
+                        decodeMsg(body, body_len, on_msg);
+                        break;
+                    }
+                    pos += head[0];
+                }
+                return pos;
+            }
+
+        private:
+            void decodeRecord(const char *body, size_t len, const MsgHandler &on_msg)
+            {
+                if (len < RECORD_HEADER_SIZE - FRAME_HEADER_SIZE)
+                {
+                    return;
+                }
+                uint32_t ids[2];
+                uint64_t t, tid;
+                memcpy(ids, body, sizeof(ids));
+                memcpy(&t, body + 8, sizeof(t));
+                memcpy(&tid, body + 16, sizeof(tid));
+                const CallSite *site = _finder(ids[0]);
+                if (site == nullptr)
+                {
+                    return;
+                }
+                _payload.clear();
+                ArgReader reader(body + 24, body + len);
+                Printf(_payload, site->_fmt, reader);
+                Message::LogMsg msg(site->_level, site->_line, site->_file, _name, _payload);
+                msg.setTime(t);
+                memcpy((void *)&msg._tid, &tid, std::min(sizeof(tid), sizeof(msg._tid)));
+                on_msg(msg);
+            }
+            void decodeMsg(const char *body, size_t len, const MsgHandler &on_msg)
+            {
+                if (len < 40)
+                {
+                    return;
+                }
+                uint32_t head[4];
+                uint64_t vals[3];
+                memcpy(head, body, sizeof(head));
+                memcpy(vals, body + 16, sizeof(vals));
+                size_t off = 40 + (size_t)head[1] + head[2];
+                if (off > len)
+                {
+                    return;
+                }
+                Message::LogMsg msg((Log_level::level)head[0], vals[0], Message::StrView(body + 40, head[1]), _name,
+                                    Message::StrView(body + off, len - off), vals[1]);
+                msg._fields = Message::StrView(body + 40 + head[1], head[2]);
+                memcpy((void *)&msg._tid, &vals[2], std::min(sizeof(vals[2]), sizeof(msg._tid)));
+                on_msg(msg);
+            }
+            // 离线解码时保存文件中的调用点信息
+            void decodeSite(const char *body, size_t len)
+            {
+                if (len < 24)
+                {
+                    return;
+                }
+                uint32_t head[2], lens[2];
+                uint64_t line;
+                memcpy(head, body, sizeof(head));
+                memcpy(&line, body + 8, sizeof(line));
+                memcpy(lens, body + 16, sizeof(lens));
+                if (24 + (size_t)lens[0] + lens[1] > len)
+                {
+                    return;
+                }
+                std::string file(body + 24, lens[0]);
+                std::string fmt(body + 24 + lens[0], lens[1]);
+                _sites[head[0]] = std::make_shared<StoredSite>(head[0], (Log_level::level)head[1], line, file, fmt);
+            }
+
+        public:
+            // 离线解码时的调用点查找
+            const CallSite *findStored(uint32_t id)
+            {
+                auto it = _sites.find(id);
+                if (it == _sites.end())
+                {
+                    return nullptr;
+                }
+                return &it->second->_site;
+            }
+
+        private:
+            std::string _name;
+            SiteFinder _finder;
+            std::string _payload;
+            std::unordered_map<uint32_t, std::shared_ptr<StoredSite>> _sites;
+        };
+    }
+// 定义静态调用点，只在首次执行时注册
+#define LOG_MASTER_CALLSITE(level, fmt)                                                       \
+    ([]() -> const log_master::BinLog::CallSite & {                                          \
+        static const log_master::BinLog::CallSite site(level, __FILE__, __LINE__, fmt);      \
+        return site; }())
+}
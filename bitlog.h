@@ -6,26 +6,113 @@
 namespace log_master
 {
     // 1.提供获取指定日志器的全局接口（避免用户自己操作单例对象）
-    Logger::ptr getLogger(const std::string &name)
+    inline Logger::ptr getLogger(const std::string &name)
     {
         return LoggerManager::getInstance().getLogger(name);
     }
-    Logger::ptr rootLogger()
+    inline const Logger::ptr &rootLogger()
     {
         return LoggerManager::getInstance().rootLogger();
     }
+// 在调用点缓存日志器(name须为常量，如LOG_MASTER_LOGGER("rpc")->info(...))：只在第一次调用时按名称查找
+#define LOG_MASTER_LOGGER(name) ([]() -> log_master::Logger * { static log_master::LoggerHandle _lm_handle(name); return _lm_handle.get(); }())
 // 2.使用宏函数对日志器的接口进行代理（代理模式）
-#define debug(fmt, ...) Debug(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define info(fmt, ...) Info(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define warning(fmt, ...) Warning(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define error(fmt, ...) Error(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define fatal(fmt, ...) Fatal(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
+//   先检查日志器的输出等级再求值参数：参数放在lambda中，等级不够时只有一次relaxed原子读取与分支；
+//   低于编译期等级LOG_MASTER_ACTIVE_LEVEL的宏直接展开为空操作，参数不会被求值
+#define LOG_MASTER_LAZY(level, call) LogIf(level, [&](log_master::Logger &_lm_logger) { _lm_logger.call; })
+//   xxx_limited(每秒条数, 突发条数, fmt, ...)与xxx_sampled(N, fmt, ...)在等级检查之后按调用点限流/采样：
+//   调用点状态是lambda中的静态对象(每个调用点一份)，被拒绝时参数不求值；放行的日志附带suppressed=N字段
+#define LOG_MASTER_GATED(level, gate_type, gate_args, call) LogIf(level, [&](log_master::Logger &_lm_logger) { \
+    static gate_type _lm_gate gate_args;                                                                      \
+    uint64_t _lm_suppressed = 0;                                                                              \
+    if (!_lm_gate.allow(_lm_suppressed))                                                                      \
+    {                                                                                                         \
+        _lm_logger.Suppress();                                                                                \
+        return;                                                                                               \
+    }                                                                                                         \
+    log_master::RateLimit::Pending _lm_pending(_lm_suppressed);                                               \
+    _lm_logger.call; })
+#if LOG_MASTER_ACTIVE_LEVEL <= LOG_MASTER_LEVEL_DEBUG
+#define debug(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::DEBUG, Debug(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define debug_fmt(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::DEBUG, LogFmt(LOG_MASTER_FMT_CHECK(fmt, ##__VA_ARGS__), log_master::Log_level::DEBUG, __FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define debug_bin(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::DEBUG, LogBinary(LOG_MASTER_CALLSITE(log_master::Log_level::DEBUG, fmt), ##__VA_ARGS__))
+#define debug_kv(msg, ...) LOG_MASTER_LAZY(log_master::Log_level::DEBUG, LogKV(log_master::Log_level::DEBUG, __FILE__, __LINE__, msg, ##__VA_ARGS__))
+#define debug_limited(rate, burst, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::DEBUG, log_master::RateLimit::TokenBucket, (rate, burst), Debug(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define debug_sampled(n, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::DEBUG, log_master::RateLimit::Sampler, (n), Debug(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#else
+#define debug(fmt, ...) LogNothing()
+#define debug_fmt(fmt, ...) LogNothing()
+#define debug_bin(fmt, ...) LogNothing()
+#define debug_kv(msg, ...) LogNothing()
+#define debug_limited(rate, burst, fmt, ...) LogNothing()
+#define debug_sampled(n, fmt, ...) LogNothing()
+#endif
+#if LOG_MASTER_ACTIVE_LEVEL <= LOG_MASTER_LEVEL_INFO
+#define info(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::INFO, Info(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define info_fmt(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::INFO, LogFmt(LOG_MASTER_FMT_CHECK(fmt, ##__VA_ARGS__), log_master::Log_level::INFO, __FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define info_bin(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::INFO, LogBinary(LOG_MASTER_CALLSITE(log_master::Log_level::INFO, fmt), ##__VA_ARGS__))
+#define info_kv(msg, ...) LOG_MASTER_LAZY(log_master::Log_level::INFO, LogKV(log_master::Log_level::INFO, __FILE__, __LINE__, msg, ##__VA_ARGS__))
+#define info_limited(rate, burst, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::INFO, log_master::RateLimit::TokenBucket, (rate, burst), Info(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define info_sampled(n, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::INFO, log_master::RateLimit::Sampler, (n), Info(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#else
+#define info(fmt, ...) LogNothing()
+#define info_fmt(fmt, ...) LogNothing()
+#define info_bin(fmt, ...) LogNothing()
+#define info_kv(msg, ...) LogNothing()
+#define info_limited(rate, burst, fmt, ...) LogNothing()
+#define info_sampled(n, fmt, ...) LogNothing()
+#endif
+#if LOG_MASTER_ACTIVE_LEVEL <= LOG_MASTER_LEVEL_WARNING
+#define warning(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::WARNING, Warning(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define warning_fmt(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::WARNING, LogFmt(LOG_MASTER_FMT_CHECK(fmt, ##__VA_ARGS__), log_master::Log_level::WARNING, __FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define warning_bin(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::WARNING, LogBinary(LOG_MASTER_CALLSITE(log_master::Log_level::WARNING, fmt), ##__VA_ARGS__))
+#define warning_kv(msg, ...) LOG_MASTER_LAZY(log_master::Log_level::WARNING, LogKV(log_master::Log_level::WARNING, __FILE__, __LINE__, msg, ##__VA_ARGS__))
+#define warning_limited(rate, burst, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::WARNING, log_master::RateLimit::TokenBucket, (rate, burst), Warning(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define warning_sampled(n, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::WARNING, log_master::RateLimit::Sampler, (n), Warning(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#else
+#define warning(fmt, ...) LogNothing()
+#define warning_fmt(fmt, ...) LogNothing()
+#define warning_bin(fmt, ...) LogNothing()
+#define warning_kv(msg, ...) LogNothing()
+#define warning_limited(rate, burst, fmt, ...) LogNothing()
+#define warning_sampled(n, fmt, ...) LogNothing()
+#endif
+#if LOG_MASTER_ACTIVE_LEVEL <= LOG_MASTER_LEVEL_ERROR
+#define error(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::ERROR, Error(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define error_fmt(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::ERROR, LogFmt(LOG_MASTER_FMT_CHECK(fmt, ##__VA_ARGS__), log_master::Log_level::ERROR, __FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define error_bin(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::ERROR, LogBinary(LOG_MASTER_CALLSITE(log_master::Log_level::ERROR, fmt), ##__VA_ARGS__))
+#define error_kv(msg, ...) LOG_MASTER_LAZY(log_master::Log_level::ERROR, LogKV(log_master::Log_level::ERROR, __FILE__, __LINE__, msg, ##__VA_ARGS__))
+#define error_limited(rate, burst, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::ERROR, log_master::RateLimit::TokenBucket, (rate, burst), Error(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define error_sampled(n, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::ERROR, log_master::RateLimit::Sampler, (n), Error(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#else
+#define error(fmt, ...) LogNothing()
+#define error_fmt(fmt, ...) LogNothing()
+#define error_bin(fmt, ...) LogNothing()
+#define error_kv(msg, ...) LogNothing()
+#define error_limited(rate, burst, fmt, ...) LogNothing()
+#define error_sampled(n, fmt, ...) LogNothing()
+#endif
+#if LOG_MASTER_ACTIVE_LEVEL <= LOG_MASTER_LEVEL_FATAL
+#define fatal(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::FATAL, Fatal(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define fatal_fmt(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::FATAL, LogFmt(LOG_MASTER_FMT_CHECK(fmt, ##__VA_ARGS__), log_master::Log_level::FATAL, __FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define fatal_bin(fmt, ...) LOG_MASTER_LAZY(log_master::Log_level::FATAL, LogBinary(LOG_MASTER_CALLSITE(log_master::Log_level::FATAL, fmt), ##__VA_ARGS__))
+#define fatal_kv(msg, ...) LOG_MASTER_LAZY(log_master::Log_level::FATAL, LogKV(log_master::Log_level::FATAL, __FILE__, __LINE__, msg, ##__VA_ARGS__))
+#define fatal_limited(rate, burst, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::FATAL, log_master::RateLimit::TokenBucket, (rate, burst), Fatal(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#define fatal_sampled(n, fmt, ...) LOG_MASTER_GATED(log_master::Log_level::FATAL, log_master::RateLimit::Sampler, (n), Fatal(__FILE__, __LINE__, fmt, ##__VA_ARGS__))
+#else
+#define fatal(fmt, ...) LogNothing()
+#define fatal_fmt(fmt, ...) LogNothing()
+#define fatal_bin(fmt, ...) LogNothing()
+#define fatal_kv(msg, ...) LogNothing()
+#define fatal_limited(rate, burst, fmt, ...) LogNothing()
+#define fatal_sampled(n, fmt, ...) LogNothing()
+#endif
 // 3.提供宏函数，直接通过默认日志器进行日志的标准输出打印（不用获取日志器）
-#define DEBUG(fmt, ...) log_master::rootLogger->debug(fmt, ##__VA_ARGS__)
-#define INFO(fmt, ...) log_master::rootLogger->info(fmt, ##__VA_ARGS__)
-#define WARNING(fmt, ...) log_master::rootLogger->warning(fmt, ##__VA_ARGS__)
-#define ERROR(fmt, ...) log_master::rootLogger->error(fmt, ##__VA_ARGS__)
-#define FATAL(fmt, ...) log_master::rootLogger->fatal(fmt, ##__VA_ARGS__)
+#define DEBUG(fmt, ...) log_master::rootLogger()->debug(fmt, ##__VA_ARGS__)
+#define INFO(fmt, ...) log_master::rootLogger()->info(fmt, ##__VA_ARGS__)
+#define WARNING(fmt, ...) log_master::rootLogger()->warning(fmt, ##__VA_ARGS__)
+#define ERROR(fmt, ...) log_master::rootLogger()->error(fmt, ##__VA_ARGS__)
+#define FATAL(fmt, ...) log_master::rootLogger()->fatal(fmt, ##__VA_ARGS__)
 }
 
 #endif
\ No newline at end of file
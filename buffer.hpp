@@ -11,7 +11,7 @@ namespace log_master
     class Buffer
     {
     public:
-        Buffer():_buffer(DEFAULT_BUFFER_SIZE),_writer_idx(0),_reader_idx(0){}
+        Buffer(size_t size = DEFAULT_BUFFER_SIZE):_buffer(size),_writer_idx(0),_reader_idx(0){}
         // 向缓冲区写入数据
         void push(const std::string &data, size_t len){
             //缓冲区剩余空间不够处理：
@@ -24,6 +24,11 @@ namespace log_master
             //将写入指针向后偏移
             moveWriter(len);
         }
+        void push(const char *data, size_t len){
+            expension(len);
+            std::copy(data,data+len,&_buffer[_writer_idx]);
+            moveWriter(len);
+        }
        
         // 返回可读数据的起始地址
         const char* begin(){
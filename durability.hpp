@@ -0,0 +1,141 @@
+#pragma once
+/*落地方向的持久化策略：写入后何时把数据刷到存储设备(通过LoggerBuilder::buildSinkDurability设置)
+    DURABILITY_NONE:不主动刷盘(默认，由ofstream缓冲与内核回写决定)
+    DURABILITY_INTERVAL:写入时距上次刷盘超过interval_ms则fsync；写入停止后，未刷盘的日志由定时器(DurabilityTimer，
+        开启写入通道时由通道线程)在到期后刷盘，写入停止后最迟约1.5个间隔落盘，不依赖下一次写入或Logger::flush()
+    DURABILITY_BATCH:每次写入后fsync；异步日志器每批一次，多个生产者的日志合并为一次提交，生产者不等待
+    DURABILITY_SYNC:每次写入后fdatasync，日志调用在所在批次刷盘后才返回(异步日志器中等待的生产者共享同一次提交)*/
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+namespace log_master
+{
+    enum DurabilityLevel
+    {
+        DURABILITY_NONE,
+        DURABILITY_INTERVAL,
+        DURABILITY_BATCH,
+        DURABILITY_SYNC
+    };
+
+    struct Durability
+    {
+        DurabilityLevel _level = DURABILITY_NONE;
+        uint32_t _interval_ms = 0; // DURABILITY_INTERVAL的刷盘间隔
+
+        static Durability None()
+        {
+            return Durability();
+        }
+        static Durability Interval(uint32_t interval_ms)
+        {
+            Durability d;
+            d._level = DURABILITY_INTERVAL;
+            d._interval_ms = interval_ms;
+            return d;
+        }
+        static Durability EveryBatch()
+        {
+            Durability d;
+            d._level = DURABILITY_BATCH;
+            return d;
+        }
+        static Durability Sync()
+        {
+            Durability d;
+            d._level = DURABILITY_SYNC;
+            return d;
+        }
+    };
+
+    // 按间隔刷盘的共享定时器：一个线程按各任务的间隔调用注册的回调(日志器在回调中与写入互斥后提交到期的落地方向)
+    //  线程在第一次注册时创建，之后常驻；remove返回后该回调不会再被调用
+    class DurabilityTimer
+    {
+    public:
+        using Task = std::function<void()>;
+        // 不析构：进程退出时日志器仍可能注销
+        static DurabilityTimer &getInstance()
+        {
+            static DurabilityTimer *timer = new DurabilityTimer();
+            return *timer;
+        }
+        size_t add(uint32_t interval_ms, const Task &task)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            size_t id = ++_next;
+            Entry &e = _tasks[id];
+            e._interval = std::chrono::milliseconds(interval_ms == 0 ? 1 : interval_ms);
+            e._due = Clock::now() + e._interval;
+            e._task = task;
+            if (!_thread.joinable())
+            {
+                _thread = std::thread(&DurabilityTimer::threadEntry, this);
+            }
+            _cond.notify_all();
+            return id;
+        }
+        // 等待正在执行的该回调返回后注销
+        void remove(size_t id)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [&]()
+                       { return _running != id; });
+            _tasks.erase(id);
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        struct Entry
+        {
+            Clock::duration _interval;
+            Clock::time_point _due;
+            Task _task;
+        };
+        DurabilityTimer() : _next(0), _running(0) {}
+        void threadEntry()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                auto due = _tasks.begin();
+                for (auto it = _tasks.begin(); it != _tasks.end(); ++it)
+                {
+                    due = it->second._due < due->second._due ? it : due;
+                }
+                if (due == _tasks.end())
+                {
+                    _cond.wait(lock);
+                    continue;
+                }
+                if (Clock::now() < due->second._due)
+                {
+                    _cond.wait_until(lock, due->second._due);
+                    continue;
+                }
+                // 回调在锁外执行，remove等待其返回，Entry在此期间不会被删除
+                _running = due->first;
+                Entry &e = due->second;
+                e._due = Clock::now() + e._interval;
+                lock.unlock();
+                e._task();
+                lock.lock();
+                _running = 0;
+                _cond.notify_all();
+            }
+        }
+
+    private:
+        std::map<size_t, Entry> _tasks;
+        size_t _next;
+        size_t _running; // 正在执行的回调(0表示没有)
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::thread _thread;
+    };
+}
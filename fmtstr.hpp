@@ -0,0 +1,255 @@
+#pragma once
+/*类型安全的{}风格格式化
+    1.编译期校验格式化字符串中{}占位符数量与参数数量是否一致({{、}}表示字面的{、})
+    2.直接格式化到调用方栈上的缓冲区，超出后转存到线程局部缓冲区(复用容量)，常见类型不产生堆分配；
+      每个线程有FMT_SPILL_SLOTS个转存缓冲区(有效载荷与封装帧可能同时溢出)，都被占用时使用自己的堆缓冲区，各Writer的内容在其生命周期内保持有效
+    支持类型:整型、枚举、bool、char、浮点、const char*、std::string、指针
+    注:C++11的constexpr递归深度默认512，格式化字符串长度需小于该值
+*/
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <memory>
+#include <type_traits>
+#include <algorithm>
+
+namespace log_master
+{
+    namespace FmtStr
+    {
+        #define FMT_STACK_SIZE 512
+        #define FMT_SPILL_SLOTS 2 // 每个线程可同时使用的转存缓冲区个数
+        // 携带编译期校验结果的标记类型
+        template <bool OK>
+        struct Checked
+        {
+        };
+        // 只用于decltype中统计参数个数，不会被求值
+        template <typename... Args>
+        std::integral_constant<size_t, sizeof...(Args)> Arity(const Args &...);
+
+        // 统计占位符个数，格式错误返回-1
+        constexpr int Count(const char *s, int n = 0)
+        {
+            return *s == '\0'                    ? n
+                   : (*s == '{' && s[1] == '{')  ? Count(s + 2, n)
+                   : (*s == '}' && s[1] == '}')  ? Count(s + 2, n)
+                   : (*s == '{' && s[1] == '}')  ? Count(s + 2, n + 1)
+                   : (*s == '{' || *s == '}')    ? -1
+                                                 : Count(s + 1, n);
+        }
+        constexpr bool Check(const char *fmt, size_t nargs)
+        {
+            return Count(fmt) == (int)nargs;
+        }
+
+        class Writer
+        {
+        public:
+            Writer() : _data(_stack), _size(0), _capacity(FMT_STACK_SIZE), _spill(nullptr), _slot(nullptr) {}
+            ~Writer()
+            {
+                if (_slot != nullptr)
+                {
+                    _slot->_busy = false;
+                }
+            }
+            Writer(const Writer &) = delete;
+            Writer &operator=(const Writer &) = delete;
+            void append(const char *s, size_t len)
+            {
+                if (_size + len > _capacity)
+                {
+                    grow(_size + len);
+                }
+                memcpy(_data + _size, s, len);
+                _size += len;
+            }
+            void push(char c)
+            {
+                append(&c, 1);
+            }
+            // 按printf格式追加：先写入剩余空间，不够时扩容后重写；格式错误返回false
+            bool vprintf(const char *fmt, va_list ap)
+            {
+                va_list cp;
+                va_copy(cp, ap);
+                int n = vsnprintf(_data + _size, _capacity - _size, fmt, cp);
+                va_end(cp);
+                if (n < 0)
+                {
+                    return false;
+                }
+                if (_size + n >= _capacity)
+                {
+                    grow(_size + n + 1); // vsnprintf需要写入结尾的'\0'
+                    vsnprintf(_data + _size, _capacity - _size, fmt, ap);
+                }
+                _size += n;
+                return true;
+            }
+            // 回填已写入区域(如先占位后写入的长度字段)
+            void overwrite(size_t pos, const void *s, size_t len)
+            {
+                memcpy(_data + pos, s, len);
+            }
+            const char *data() { return _data; }
+            size_t size() { return _size; }
+
+        private:
+            // 栈缓冲区不够时转存到线程局部缓冲区，容量在线程内复用；本线程的转存缓冲区都被其他Writer占用时改用自己的堆缓冲区
+            void grow(size_t need)
+            {
+                if (_spill == nullptr)
+                {
+                    Spill *slots = ThreadSpill();
+                    for (size_t i = 0; i < FMT_SPILL_SLOTS && _slot == nullptr; i++)
+                    {
+                        if (!slots[i]._busy)
+                        {
+                            _slot = &slots[i];
+                            _slot->_busy = true;
+                            _spill = &_slot->_buf;
+                        }
+                    }
+                    if (_slot == nullptr)
+                    {
+                        _own.reset(new std::string());
+                        _spill = _own.get();
+                    }
+                    _spill->assign(_stack, _size);
+                }
+                size_t cap = std::max(need, _capacity * 2);
+                _spill->resize(cap);
+                _data = &(*_spill)[0];
+                _capacity = cap;
+            }
+            struct Spill
+            {
+                std::string _buf;
+                bool _busy = false;
+            };
+            static Spill *ThreadSpill()
+            {
+                static thread_local Spill spill[FMT_SPILL_SLOTS];
+                return spill;
+            }
+
+        private:
+            char _stack[FMT_STACK_SIZE];
+            char *_data;
+            size_t _size;
+            size_t _capacity;
+            std::string *_spill;               // 溢出后使用的缓冲区
+            Spill *_slot;                      // 占用的线程局部转存缓冲区
+            std::unique_ptr<std::string> _own; // 线程局部缓冲区被占用时的私有缓冲区
+        };
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value>::type WriteArg(Writer &w, T v)
+        {
+            char tmp[24];
+            char *end = tmp + sizeof(tmp);
+            char *p = end;
+            typedef typename std::make_unsigned<T>::type U;
+            U u = (U)v;
+            bool neg = v < 0;
+            if (neg)
+            {
+                u = (U)0 - u;
+            }
+            do
+            {
+                *--p = (char)('0' + u % 10);
+                u /= 10;
+            } while (u != 0);
+            if (neg)
+            {
+                *--p = '-';
+            }
+            w.append(p, end - p);
+        }
+        template <typename T>
+        typename std::enable_if<std::is_enum<T>::value>::type WriteArg(Writer &w, T v)
+        {
+            WriteArg(w, (typename std::underlying_type<T>::type)v);
+        }
+        inline void WriteArg(Writer &w, bool v)
+        {
+            v ? w.append("true", 4) : w.append("false", 5);
+        }
+        inline void WriteArg(Writer &w, char c)
+        {
+            w.push(c);
+        }
+        // 先尝试15位有效数字(多数值更短)，无法精确还原时使用17位，不丢失精度
+        inline void WriteArg(Writer &w, double v)
+        {
+            char tmp[32];
+            int n = snprintf(tmp, sizeof(tmp), "%.15g", v);
+            if (v == v && strtod(tmp, nullptr) != v)
+            {
+                n = snprintf(tmp, sizeof(tmp), "%.17g", v);
+            }
+            w.append(tmp, n);
+        }
+        inline void WriteArg(Writer &w, const char *s)
+        {
+            if (s == nullptr)
+            {
+                s = "(null)";
+            }
+            w.append(s, strlen(s));
+        }
+        inline void WriteArg(Writer &w, const std::string &s)
+        {
+            w.append(s.data(), s.size());
+        }
+        inline void WriteArg(Writer &w, const void *p)
+        {
+            char tmp[24];
+            int n = snprintf(tmp, sizeof(tmp), "%p", p);
+            w.append(tmp, n);
+        }
+
+        // 写出下一个占位符之前的字面内容，返回占位符之后的位置
+        inline const char *WriteLiteral(Writer &w, const char *fmt)
+        {
+            const char *begin = fmt;
+            while (*fmt != '\0')
+            {
+                if (*fmt == '{' || *fmt == '}')
+                {
+                    w.append(begin, fmt - begin);
+                    if (fmt[1] == *fmt) // {{ 或 }}
+                    {
+                        w.push(*fmt);
+                        fmt += 2;
+                        begin = fmt;
+                        continue;
+                    }
+                    return fmt + 2; // {}
+                }
+                fmt++;
+            }
+            w.append(begin, fmt - begin);
+            return fmt;
+        }
+        inline void Format(Writer &w, const char *fmt)
+        {
+            WriteLiteral(w, fmt);
+        }
+        template <typename T, typename... Rest>
+        void Format(Writer &w, const char *fmt, const T &arg, const Rest &...rest)
+        {
+            fmt = WriteLiteral(w, fmt);
+            WriteArg(w, arg);
+            Format(w, fmt, rest...);
+        }
+    }
+// 生成编译期校验结果，格式化字符串必须是字符串字面量
+#define LOG_MASTER_FMT_CHECK(fmt, ...) \
+    log_master::FmtStr::Checked<log_master::FmtStr::Check(fmt, decltype(log_master::FmtStr::Arity(__VA_ARGS__))::value)>()
+}
@@ -1,126 +1,217 @@
 #pragma once
 /*⽇志格式化（format）类主要负责格式化日志消息*/
-/*  MsgFormatltem:表示要从LogMsg中取出有效日志数据
-    LevelFormatItem:表示要从LogMsg中取出日志等级
-    NameFormatItem:表示要从LogMsg中取出日志器名称
-    ThreadFormatItem:表示要从LogMsg中取出线程ID
-    TimeFormatItem:表示要从LogMsg中取出时间戳并按照指定格式进行格式化
-    CFileFormatItem:表示要从LogMsg中取出源码所在文件名
-    CLineFormatItem:表示要从LogMsg中取出源码所在行号
-    TabFormatItem:表示⼀个制表符缩进
-    NLineFormatItem:表示⼀个换行
-    OtherFormatItem:表示非格式化的原始字符串*/
+/*  格式化规则在构造时被编译为一组扁平的格式化指令(FormatOp)，格式化时按顺序执行：
+    OP_MSG:表示要从LogMsg中取出有效日志数据
+    OP_LEVEL:表示要从LogMsg中取出日志等级
+    OP_NAME:表示要从LogMsg中取出日志器名称
+    OP_THREAD:表示要从LogMsg中取出线程ID
+    OP_TIME:表示要从LogMsg中取出时间戳并按照指定格式进行格式化
+    OP_SUBSEC:表示时间戳的亚秒部分(%d{}中的%3N毫秒、%6N微秒、%9N或%N纳秒)
+    OP_FILE:表示要从LogMsg中取出源码所在文件名
+    OP_LINE:表示要从LogMsg中取出源码所在行号
+    OP_LITERAL:表示非格式化的原始字符串(相邻的原始字符串、%T制表符、%n换行会合并为一条指令)
+    结构化格式(FORMAT_JSON/FORMAT_LOGFMT)每条日志输出为一行JSON对象或logfmt，结构化字段直接写入输出缓冲区；
+    普通格式下结构化字段以" key=value"的形式追加在日志消息之后*/
 #include <iostream>
 #include <time.h>
 #include <cassert>
+#include <cstring>
+#include <cstdint>
 #include <vector>
 #include <sstream>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
 
 #include "./message.hpp"
+#include "./structured.hpp"
 
 namespace log_master
 {
-    class FormatItem
-    {
-    public:
-        using ptr = std::shared_ptr<FormatItem>;
-        virtual void format(std::ostream &out, const log_master::Message::LogMsg &Msg) = 0;
-    };
+    #define DEFAULT_FORMAT_PATTERN "[%d{%H:%M:%S}] [%t] [%p] [%c] [%f:%l]%T%m%n"
+    #define STRUCTURED_TIME_FORMAT "%Y-%m-%dT%H:%M:%S.%6N" // 结构化格式默认的时间格式
 
-    class MsgFormatItem : public FormatItem
+    enum FormatMode
     {
-    public:
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
-        {
-            out << Msg._payload;
-        }
+        FORMAT_PATTERN, // 按格式化规则字符串输出
+        FORMAT_JSON,    // 每条日志一行JSON对象
+        FORMAT_LOGFMT   // 每条日志一行logfmt(key=value，以空格分隔)
     };
-    class LevelFormatItem : public FormatItem
+    struct FormatOp
     {
-    public:
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
+        enum OpType
         {
-            out << log_master::Log_level::ToString(Msg._level);
-        }
+            OP_LITERAL,
+            OP_TIME,
+            OP_SUBSEC,
+            OP_THREAD,
+            OP_LEVEL,
+            OP_NAME,
+            OP_FILE,
+            OP_LINE,
+            OP_MSG
+        };
+        FormatOp(OpType type, const std::string &arg = "", uint32_t key = 0) : _type(type), _arg(arg), _key(key) {}
+        OpType _type;
+        std::string _arg; // 原始字符串或时间格式
+        uint32_t _key;    // 时间格式在TimeCache中的键/亚秒位数
     };
-    class ThreadFormatItem : public FormatItem
+
+    namespace FormatUtil
     {
-    public:
-       void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
+        inline void AppendUInt(std::string &out, uint64_t v)
         {
-            out << Msg._tid;
+            char tmp[24];
+            char *end = tmp + sizeof(tmp);
+            char *p = end;
+            do
+            {
+                *--p = (char)('0' + v % 10);
+                v /= 10;
+            } while (v != 0);
+            out.append(p, end - p);
         }
-    };
-    class TimeFormatItem : public FormatItem
-    {
-    public:
-        TimeFormatItem(const std::string &tf = "[%H:%M:%S]") : _tf(tf) {}
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
+        // 时间戳缓存：每个线程缓存每种时间格式最近一次的渲染结果，
+        // 只有秒数变化时才重新调用localtime_r(持有glibc时区锁)和strftime
+        class TimeCache
         {
-            struct tm t;
-            localtime_r(&Msg._ctime, &t);
-            char tmp[32];
-            strftime(tmp, 32, _tf.c_str(), &t);
-            out << tmp;
-        }
+        public:
+            static void Append(std::string &out, time_t ctime, const std::string &tf, uint32_t key)
+            {
+                Entry &e = Entries()[key % SLOTS];
+                if (e._key != key || e._sec != ctime)
+                {
+                    struct tm t;
+                    localtime_r(&ctime, &t);
+                    e._len = strftime(e._buf, sizeof(e._buf), tf.c_str(), &t);
+                    e._key = key;
+                    e._sec = ctime;
+                }
+                out.append(e._buf, e._len);
+            }
+            // 为每条时间格式化指令分配唯一的键(0表示未缓存)
+            static uint32_t NewKey()
+            {
+                static std::atomic<uint32_t> next(1);
+                return next++;
+            }
 
-    private:
-        std::string _tf;
-    };
-    class NameFormatItem : public FormatItem
-    {
-    public:
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
-        {
-            out << Msg._name;
-        }
-    };
-    class CFileFormatItem : public FormatItem
-    {
-    public:
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
+        private:
+            static const size_t SLOTS = 8;
+            struct Entry
+            {
+                uint32_t _key;
+                time_t _sec;
+                size_t _len;
+                char _buf[64];
+            };
+            static Entry *Entries()
+            {
+                static thread_local Entry entries[SLOTS] = {};
+                return entries;
+            }
+        };
+        // 输出亚秒部分，digits为3/6/9位(补零)
+        inline void AppendSubSec(std::string &out, uint32_t nsec, uint32_t digits)
         {
-            out << Msg._file;
+            char tmp[9];
+            for (uint32_t i = digits; i < 9; i++)
+            {
+                nsec /= 10;
+            }
+            for (uint32_t i = digits; i > 0; i--)
+            {
+                tmp[i - 1] = (char)('0' + nsec % 10);
+                nsec /= 10;
+            }
+            out.append(tmp, digits);
         }
-    };
-    class CLineFormatItem : public FormatItem
-    {
-    public:
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
+        // 与std::thread::id的流输出一致(输出底层线程句柄的数值)
+        inline void AppendThread(std::string &out, const std::thread::id &tid)
         {
-            out << Msg._line;
+            uint64_t v = 0;
+            memcpy(&v, (const void *)&tid, std::min(sizeof(v), sizeof(tid)));
+            AppendUInt(out, v);
         }
-    };
-    class TabFormatItem : public FormatItem
-    {
-    public:
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
+        inline void AppendInt(std::string &out, int64_t v)
         {
-            out << "\t";
+            if (v < 0)
+            {
+                out.push_back('-');
+                AppendUInt(out, (uint64_t)0 - (uint64_t)v);
+                return;
+            }
+            AppendUInt(out, (uint64_t)v);
         }
-    };
-    class NLineFormatItem : public FormatItem
-    {
-    public:
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
+        // 先尝试15位有效数字(多数值更短)，无法精确还原时使用17位；NaN/Inf在JSON中输出为字符串
+        inline void AppendDouble(std::string &out, double v, bool json)
         {
-            out << "\n";
+            if (std::isnan(v) || std::isinf(v))
+            {
+                const char *s = std::isnan(v) ? "NaN" : (v > 0 ? "+Inf" : "-Inf");
+                json ? Structured::AppendJsonString(out, s, strlen(s)) : (void)out.append(s);
+                return;
+            }
+            char tmp[32];
+            int n = snprintf(tmp, sizeof(tmp), "%.15g", v);
+            if (strtod(tmp, nullptr) != v)
+            {
+                n = snprintf(tmp, sizeof(tmp), "%.17g", v);
+            }
+            out.append(tmp, n);
         }
-    };
-    class OtherFormatItem : public FormatItem
-    {
-    public:
-        OtherFormatItem(const std::string &str) : _str(str) {}
-        void format(std::ostream &out, const log_master::Message::LogMsg &Msg) override
+        // 输出结构化字段：JSON为 ,"key":value ，logfmt为 空格key=value
+        inline void AppendFields(std::string &out, const Message::StrView &fields, bool json)
         {
-            out << _str;
+            Structured::FieldReader reader(fields.data(), fields.size());
+            Structured::FieldView f = Structured::FieldView();
+            while (reader.next(f))
+            {
+                if (json)
+                {
+                    out.push_back(',');
+                    Structured::AppendJsonString(out, f._key, f._key_len);
+                    out.push_back(':');
+                }
+                else
+                {
+                    out.push_back(' ');
+                    out.append(f._key, f._key_len);
+                    out.push_back('=');
+                }
+                switch (f._tag)
+                {
+                case Structured::FIELD_INT:
+                    AppendInt(out, (int64_t)f._bits);
+                    break;
+                case Structured::FIELD_UINT:
+                    AppendUInt(out, f._bits);
+                    break;
+                case Structured::FIELD_DOUBLE:
+                {
+                    double v;
+                    memcpy(&v, &f._bits, sizeof(v));
+                    AppendDouble(out, v, json);
+                    break;
+                }
+                case Structured::FIELD_BOOL:
+                    f._bits ? out.append("true", 4) : out.append("false", 5);
+                    break;
+                case Structured::FIELD_STR:
+                    json ? Structured::AppendJsonString(out, f._str, f._len) : Structured::AppendLogfmtValue(out, f._str, f._len);
+                    break;
+                default:
+                    out.append("null", 4);
+                    break;
+                }
+            }
         }
+    }
 
-    private:
-        std::string _str;
-    };
-
-    /*  %d 日期
+    /*  %d 日期(花括号内为strftime格式，另支持%3N毫秒、%6N微秒、%9N纳秒)
         %T 缩进
         %t 线程id
         %p 日志级别
@@ -133,25 +224,91 @@ namespace log_master
     {
     public:
         using ptr=std::shared_ptr<Formatter>;
-        Formatter(const std::string &pattern = "[%d{%H:%M:%S}] [%t] [%p] [%c] [%f:%l]%T%m%n") : _pattern(pattern)
+        Formatter(const std::string &pattern = DEFAULT_FORMAT_PATTERN) : _pattern(pattern), _literal_size(0), _is_default(pattern == DEFAULT_FORMAT_PATTERN), _mode(FORMAT_PATTERN)
         {
-            assert(ParsePattern());
+            bool ret = ParsePattern();
+            assert(ret);
+            (void)ret;
         }
-        // 对Msg进行格式化
-        void Format(std::ostream &out, log_master::Message::LogMsg &Msg)
+        // 结构化格式，time_format与%d{}的子格式相同(logfmt下不应含空格)
+        Formatter(FormatMode mode, const std::string &time_format = STRUCTURED_TIME_FORMAT) : _literal_size(64), _is_default(false), _mode(mode)
         {
-
-            for (auto &e : _items)
+            assert(mode != FORMAT_PATTERN); // 普通格式使用Formatter(pattern)
+            // _pattern只用于区分不同的格式(落地方向按其分组)
+            _pattern = (mode == FORMAT_JSON ? "<json>" : "<logfmt>") + time_format;
+            AddTime(time_format);
+        }
+        // 对Msg进行格式化，追加到out末尾(out可复用，避免重复分配)
+        void Format(std::string &out, const log_master::Message::LogMsg &Msg)
+        {
+            out.reserve(out.size() + _literal_size + Msg._payload.size() + Msg._fields.size() + Msg._file.size() + Msg._name.size() + 64);
+            if (_mode == FORMAT_JSON)
             {
-                 e->format(out, Msg);
+                FormatJson(out, Msg);
+                return;
             }
+            if (_mode == FORMAT_LOGFMT)
+            {
+                FormatLogfmt(out, Msg);
+                return;
+            }
+            if (_is_default)
+            {
+                FormatDefault(out, Msg);
+                return;
+            }
+            for (auto &op : _ops)
+            {
+                switch (op._type)
+                {
+                case FormatOp::OP_LITERAL:
+                    out.append(op._arg);
+                    break;
+                case FormatOp::OP_TIME:
+                    FormatUtil::TimeCache::Append(out, Msg._ctime, op._arg, op._key);
+                    break;
+                case FormatOp::OP_SUBSEC:
+                    FormatUtil::AppendSubSec(out, Msg._nsec, op._key);
+                    break;
+                case FormatOp::OP_THREAD:
+                    FormatUtil::AppendThread(out, Msg._tid);
+                    break;
+                case FormatOp::OP_LEVEL:
+                    out.append(Log_level::ToCString(Msg._level));
+                    break;
+                case FormatOp::OP_NAME:
+                    out.append(Msg._name.data(), Msg._name.size());
+                    break;
+                case FormatOp::OP_FILE:
+                    out.append(Msg._file.data(), Msg._file.size());
+                    break;
+                case FormatOp::OP_LINE:
+                    FormatUtil::AppendUInt(out, Msg._line);
+                    break;
+                case FormatOp::OP_MSG:
+                    out.append(Msg._payload.data(), Msg._payload.size());
+                    if (!Msg._fields.empty())
+                    {
+                        FormatUtil::AppendFields(out, Msg._fields, false);
+                    }
+                    break;
+                }
+            }
+        }
+        void Format(std::ostream &out, log_master::Message::LogMsg &Msg)
+        {
+            std::string str;
+            Format(str, Msg);
+            out.write(str.data(), str.size());
         }
         std::string Format(log_master::Message::LogMsg &Msg)
         {
-            std::stringstream ss;
-            Format(ss, Msg);
-            return ss.str();
+            std::string str;
+            Format(str, Msg);
+            return str;
         }
+        const std::string &pattern() { return _pattern; }
+        FormatMode mode() { return _mode; }
         // 对格式化规则字符串进行解析
         private:
         bool ParsePattern()
@@ -179,7 +336,7 @@ namespace log_master
                 // 处理格式化字符串前，先处理非格式化字符串
                 if (val.empty() == false)
                 {
-                    _items.push_back(CreateItem(key, val));
+                    AddOp(key, val);
                     val.clear();
                 }
 
@@ -210,64 +367,209 @@ namespace log_master
                     }
                     pos++;
                 }
-                    _items.push_back(CreateItem(key,val));
+                    AddOp(key,val);
                     key.clear();
                     val.clear();
-                
+
+            }
+            if (val.empty() == false)
+            {
+                AddOp(key, val);
             }
             return true;
         }
 
     private:
-        // 根据不同的格式化字符创建不同的格式化子对象
-        std::shared_ptr<FormatItem> CreateItem(const std::string &key, const std::string &val)
+        // 根据不同的格式化字符生成不同的格式化指令，原始字符串与前一条原始字符串指令合并
+        void AddOp(const std::string &key, const std::string &val)
         {
             if (key == "d")
             {
-               return std::make_shared<TimeFormatItem>(val);
+                AddTime(val.empty() ? "%H:%M:%S" : val);
+                return;
             }
             if (key == "T")
             {
-              return  std::make_shared<TabFormatItem>();
+                AddLiteral("\t");
+                return;
             }
             if (key == "t")
             {
-               return std::make_shared<ThreadFormatItem>();
+                _ops.push_back(FormatOp(FormatOp::OP_THREAD));
+                return;
             }
             if (key == "p")
             {
-               return std::make_shared<LevelFormatItem>();
+                _ops.push_back(FormatOp(FormatOp::OP_LEVEL));
+                return;
             }
             if (key == "c")
             {
-               return std::make_shared<NameFormatItem>();
+                _ops.push_back(FormatOp(FormatOp::OP_NAME));
+                return;
             }
             if (key == "f")
             {
-               return std::make_shared<CFileFormatItem>();
+                _ops.push_back(FormatOp(FormatOp::OP_FILE));
+                return;
             }
             if (key == "l")
             {
-               return std::make_shared<CLineFormatItem>();
+                _ops.push_back(FormatOp(FormatOp::OP_LINE));
+                return;
             }
             if (key == "m")
             {
-               return std::make_shared<MsgFormatItem>();
+                _ops.push_back(FormatOp(FormatOp::OP_MSG));
+                return;
             }
             if (key == "n")
             {
-                return std::make_shared<NLineFormatItem>();
+                AddLiteral("\n");
+                return;
             }
             if(!key.empty()){
                 std::cout<<"没有对应的格式化字符%"<<key<<std::endl;
                 abort();
             }
-
-            return std::make_shared<OtherFormatItem>(val);
+            AddLiteral(val);
+        }
+        // 将时间格式按亚秒说明符(%N/%3N/%6N/%9N)拆分，其余部分交给strftime并按秒缓存
+        void AddTime(const std::string &tf)
+        {
+            std::string piece;
+            size_t pos = 0;
+            while (pos < tf.size())
+            {
+                if (tf[pos] != '%' || pos + 1 == tf.size())
+                {
+                    piece += tf[pos++];
+                    continue;
+                }
+                uint32_t digits = 0;
+                size_t skip = 2;
+                if (tf[pos + 1] == 'N')
+                {
+                    digits = 9;
+                }
+                else if (pos + 2 < tf.size() && tf[pos + 2] == 'N' && (tf[pos + 1] == '3' || tf[pos + 1] == '6' || tf[pos + 1] == '9'))
+                {
+                    digits = tf[pos + 1] - '0';
+                    skip = 3;
+                }
+                if (digits == 0)
+                {
+                    piece.append(tf, pos, 2); // 普通strftime说明符(含%%)
+                    pos += 2;
+                    continue;
+                }
+                if (!piece.empty())
+                {
+                    _ops.push_back(FormatOp(FormatOp::OP_TIME, piece, FormatUtil::TimeCache::NewKey()));
+                    piece.clear();
+                }
+                _ops.push_back(FormatOp(FormatOp::OP_SUBSEC, "", digits));
+                pos += skip;
+            }
+            if (!piece.empty())
+            {
+                _ops.push_back(FormatOp(FormatOp::OP_TIME, piece, FormatUtil::TimeCache::NewKey()));
+            }
+        }
+        void AddLiteral(const std::string &str)
+        {
+            _literal_size += str.size();
+            if (!_ops.empty() && _ops.back()._type == FormatOp::OP_LITERAL)
+            {
+                _ops.back()._arg += str;
+                return;
+            }
+            _ops.push_back(FormatOp(FormatOp::OP_LITERAL, str));
+        }
+        // 默认格式"[%d{%H:%M:%S}] [%t] [%p] [%c] [%f:%l]%T%m%n"的特化实现
+        void FormatDefault(std::string &out, const log_master::Message::LogMsg &Msg)
+        {
+            out.push_back('[');
+            FormatUtil::TimeCache::Append(out, Msg._ctime, _ops[1]._arg, _ops[1]._key);
+            out.append("] [", 3);
+            FormatUtil::AppendThread(out, Msg._tid);
+            out.append("] [", 3);
+            out.append(Log_level::ToCString(Msg._level));
+            out.append("] [", 3);
+            out.append(Msg._name.data(), Msg._name.size());
+            out.append("] [", 3);
+            out.append(Msg._file.data(), Msg._file.size());
+            out.push_back(':');
+            FormatUtil::AppendUInt(out, Msg._line);
+            out.append("]\t", 2);
+            out.append(Msg._payload.data(), Msg._payload.size());
+            if (!Msg._fields.empty())
+            {
+                FormatUtil::AppendFields(out, Msg._fields, false);
+            }
+            out.push_back('\n');
+        }
+        // 结构化格式的时间部分(_ops中只有时间指令)
+        void AppendTime(std::string &out, const log_master::Message::LogMsg &Msg)
+        {
+            for (auto &op : _ops)
+            {
+                if (op._type == FormatOp::OP_TIME)
+                {
+                    FormatUtil::TimeCache::Append(out, Msg._ctime, op._arg, op._key);
+                }
+                else
+                {
+                    FormatUtil::AppendSubSec(out, Msg._nsec, op._key);
+                }
+            }
+        }
+        // {"time":"...","level":"INFO","logger":"root","thread":1,"file":"a.cc","line":1,"msg":"...",字段...}
+        void FormatJson(std::string &out, const log_master::Message::LogMsg &Msg)
+        {
+            out.append("{\"time\":\"", 9);
+            AppendTime(out, Msg);
+            out.append("\",\"level\":\"", 11);
+            out.append(Log_level::ToCString(Msg._level));
+            out.append("\",\"logger\":", 11);
+            Structured::AppendJsonString(out, Msg._name.data(), Msg._name.size());
+            out.append(",\"thread\":", 10);
+            FormatUtil::AppendThread(out, Msg._tid);
+            out.append(",\"file\":", 8);
+            Structured::AppendJsonString(out, Msg._file.data(), Msg._file.size());
+            out.append(",\"line\":", 8);
+            FormatUtil::AppendUInt(out, Msg._line);
+            out.append(",\"msg\":", 7);
+            Structured::AppendJsonString(out, Msg._payload.data(), Msg._payload.size());
+            FormatUtil::AppendFields(out, Msg._fields, true);
+            out.append("}\n", 2);
+        }
+        // time=... level=INFO logger=root thread=1 file=a.cc line=1 msg="..." 字段...
+        void FormatLogfmt(std::string &out, const log_master::Message::LogMsg &Msg)
+        {
+            out.append("time=", 5);
+            AppendTime(out, Msg);
+            out.append(" level=", 7);
+            out.append(Log_level::ToCString(Msg._level));
+            out.append(" logger=", 8);
+            Structured::AppendLogfmtValue(out, Msg._name.data(), Msg._name.size());
+            out.append(" thread=", 8);
+            FormatUtil::AppendThread(out, Msg._tid);
+            out.append(" file=", 6);
+            Structured::AppendLogfmtValue(out, Msg._file.data(), Msg._file.size());
+            out.append(" line=", 6);
+            FormatUtil::AppendUInt(out, Msg._line);
+            out.append(" msg=", 5);
+            Structured::AppendLogfmtValue(out, Msg._payload.data(), Msg._payload.size());
+            FormatUtil::AppendFields(out, Msg._fields, false);
+            out.push_back('\n');
         }
 
     private:
         std::string _pattern;
-        std::vector<FormatItem::ptr> _items;
+        std::vector<FormatOp> _ops;
+        size_t _literal_size; // 原始字符串总长度，用于预留空间
+        bool _is_default;     // 是否为默认格式(走特化实现)
+        FormatMode _mode;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,435 @@
+#pragma once
+/*文件写入引擎：文件类落地方向(FileSink/RollSink)的底层写入实现
+    1.IoEngine抽象基类:按显式偏移量写入文件
+    2.PwriteIoEngine:同步pwrite写入，不经过ofstream的用户态缓冲
+    3.UringIoEngine:io_uring异步写入(直接使用系统调用，不依赖liburing)，不可用时退化为pwrite
+    4.LogFile:以追加方式写入的日志文件，未指定引擎时沿用ofstream(刷盘时另开一个只读描述符fsync)
+  同一个引擎可以被多个落地方向共享；异步引擎提交的数据在wait()返回前必须保持有效*/
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define LOG_MASTER_HAS_IO_URING 1
+#endif
+
+namespace log_master
+{
+    #define DEFAULT_URING_ENTRIES 64
+    #define MAX_URING_WRITE_SIZE (1u << 30) // 单个请求的最大写入长度(sqe长度字段为32位)
+
+    enum IoEngineType
+    {
+        IO_ENGINE_PWRITE, // 同步pwrite
+        IO_ENGINE_URING   // io_uring异步写入
+    };
+
+    class IoEngine
+    {
+    public:
+        using ptr = std::shared_ptr<IoEngine>;
+        virtual ~IoEngine() {}
+        // 将data写入fd的off偏移处；异步引擎只提交请求，data在wait()返回前必须保持有效
+        virtual void write(int fd, const char *data, size_t len, off_t off) = 0;
+        // 等待所有已提交的写入完成
+        virtual void wait() {}
+        // 写入是否异步完成
+        virtual bool async() { return false; }
+        // 是否发生过写入错误
+        bool failed() { return _failed; }
+
+        // 同步写入全部数据(处理部分写入与EINTR)
+        static bool WriteAll(int fd, const char *data, size_t len, off_t off)
+        {
+            while (len > 0)
+            {
+                ssize_t ret = ::pwrite(fd, data, len, off);
+                if (ret < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                data += ret;
+                len -= ret;
+                off += ret;
+            }
+            return true;
+        }
+        // 将fd已写入的数据刷到存储设备(data_only时使用fdatasync，不等待无关的元数据)
+        static bool Sync(int fd, bool data_only)
+        {
+            return (data_only ? ::fdatasync(fd) : ::fsync(fd)) == 0;
+        }
+
+    protected:
+        std::atomic<bool> _failed{false};
+    };
+
+    class PwriteIoEngine : public IoEngine
+    {
+    public:
+        void write(int fd, const char *data, size_t len, off_t off) override
+        {
+            if (!WriteAll(fd, data, len, off))
+            {
+                _failed = true;
+            }
+        }
+    };
+
+#ifdef LOG_MASTER_HAS_IO_URING
+    // io_uring写入引擎：提交后立即返回，由wait()收割完成事件
+    //  部分写入或出错的请求在收割时用pwrite补写
+    class UringIoEngine : public IoEngine
+    {
+    public:
+        UringIoEngine(unsigned entries = DEFAULT_URING_ENTRIES) : _ring_fd(-1), _sq_ptr(MAP_FAILED), _cq_ptr(MAP_FAILED), _sqes(nullptr), _inflight(0), _broken(false)
+        {
+            struct io_uring_params p;
+            memset(&p, 0, sizeof(p));
+            _ring_fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+            if (_ring_fd < 0)
+            {
+                return;
+            }
+            _sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            _cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+            bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+            if (single)
+            {
+                _sq_len = _cq_len = std::max(_sq_len, _cq_len);
+            }
+            _sq_ptr = mmap(nullptr, _sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+            if (_sq_ptr == MAP_FAILED)
+            {
+                release();
+                return;
+            }
+            _cq_ptr = single ? _sq_ptr : mmap(nullptr, _cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_CQ_RING);
+            _sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+            void *sqes = mmap(nullptr, _sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+            if (_cq_ptr == MAP_FAILED || sqes == MAP_FAILED)
+            {
+                release();
+                return;
+            }
+            _sqes = (struct io_uring_sqe *)sqes;
+            char *sq = (char *)_sq_ptr;
+            char *cq = (char *)_cq_ptr;
+            _sq_tail = (unsigned *)(sq + p.sq_off.tail);
+            _sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+            _sq_array = (unsigned *)(sq + p.sq_off.array);
+            _cq_head = (unsigned *)(cq + p.cq_off.head);
+            _cq_tail = (unsigned *)(cq + p.cq_off.tail);
+            _cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+            _cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+            _reqs.resize(p.sq_entries);
+            for (unsigned i = 0; i < p.sq_entries; i++)
+            {
+                _free.push_back(i);
+            }
+        }
+        ~UringIoEngine()
+        {
+            wait();
+            release();
+        }
+        // io_uring是否初始化成功(内核不支持或被seccomp禁止时失败)
+        bool ok() { return _sqes != nullptr; }
+        bool async() override { return true; }
+        void write(int fd, const char *data, size_t len, off_t off) override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (len > 0)
+            {
+                size_t n = std::min(len, (size_t)MAX_URING_WRITE_SIZE);
+                submit(fd, data, n, off);
+                data += n;
+                len -= n;
+                off += n;
+            }
+        }
+        void wait() override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            reap();
+            while (_inflight > 0 && enter(0, 1, IORING_ENTER_GETEVENTS))
+            {
+                reap();
+            }
+        }
+
+    private:
+        struct Request
+        {
+            int _fd;
+            const char *_data;
+            size_t _len;
+            off_t _off;
+            struct iovec _iov;
+        };
+        void submit(int fd, const char *data, size_t len, off_t off)
+        {
+            // 提交队列已满(或io_uring已失效)时先收割完成事件
+            while (!_broken && _free.empty())
+            {
+                if (!enter(0, 1, IORING_ENTER_GETEVENTS))
+                {
+                    break;
+                }
+                reap();
+            }
+            if (_broken)
+            {
+                if (!WriteAll(fd, data, len, off))
+                {
+                    _failed = true;
+                }
+                return;
+            }
+            unsigned slot = _free.back();
+            _free.pop_back();
+            Request &req = _reqs[slot];
+            req = Request{fd, data, len, off, {(void *)data, len}};
+
+            unsigned tail = *_sq_tail;
+            unsigned idx = tail & _sq_mask;
+            struct io_uring_sqe *sqe = &_sqes[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->fd = fd;
+            sqe->off = off;
+            sqe->addr = (unsigned long)&req._iov;
+            sqe->len = 1;
+            sqe->user_data = slot;
+            _sq_array[idx] = idx;
+            __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+            _inflight++;
+            if (!enter(1, 0, 0))
+            {
+                // 请求未被内核取走，io_uring已不再使用，直接同步写入
+                _inflight--;
+                _free.push_back(slot);
+                if (!WriteAll(fd, data, len, off))
+                {
+                    _failed = true;
+                }
+            }
+        }
+        bool enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+        {
+            while (true)
+            {
+                int ret = (int)syscall(__NR_io_uring_enter, _ring_fd, to_submit, min_complete, flags, nullptr, 0);
+                if (ret >= 0)
+                {
+                    return true;
+                }
+                if (errno != EINTR)
+                {
+                    _broken = true;
+                    return false;
+                }
+            }
+        }
+        void reap()
+        {
+            unsigned head = *_cq_head;
+            unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+            while (head != tail)
+            {
+                struct io_uring_cqe *cqe = &_cqes[head & _cq_mask];
+                Request &req = _reqs[cqe->user_data];
+                size_t done = cqe->res < 0 ? 0 : (size_t)cqe->res;
+                if (done < req._len && !WriteAll(req._fd, req._data + done, req._len - done, req._off + done))
+                {
+                    _failed = true;
+                }
+                _free.push_back((unsigned)cqe->user_data);
+                _inflight--;
+                head++;
+            }
+            __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+        }
+        void release()
+        {
+            if (_sqes != nullptr)
+            {
+                munmap(_sqes, _sqes_len);
+                _sqes = nullptr;
+            }
+            if (_cq_ptr != MAP_FAILED && _cq_ptr != _sq_ptr)
+            {
+                munmap(_cq_ptr, _cq_len);
+            }
+            if (_sq_ptr != MAP_FAILED)
+            {
+                munmap(_sq_ptr, _sq_len);
+            }
+            _sq_ptr = _cq_ptr = MAP_FAILED;
+            if (_ring_fd >= 0)
+            {
+                ::close(_ring_fd);
+                _ring_fd = -1;
+            }
+        }
+
+    private:
+        int _ring_fd;
+        void *_sq_ptr;
+        void *_cq_ptr;
+        size_t _sq_len;
+        size_t _cq_len;
+        size_t _sqes_len;
+        struct io_uring_sqe *_sqes;
+        unsigned *_sq_tail;
+        unsigned *_sq_array;
+        unsigned _sq_mask;
+        unsigned *_cq_head;
+        unsigned *_cq_tail;
+        unsigned _cq_mask;
+        struct io_uring_cqe *_cqes;
+        std::vector<Request> _reqs;  // 按槽位保存在途请求(iovec需保持有效)
+        std::vector<unsigned> _free; // 空闲槽位
+        unsigned _inflight;          // 已提交未收割的请求数
+        bool _broken;                // io_uring_enter失败后退化为同步写入
+        std::mutex _mutex;
+    };
+#endif
+
+    class IoEngineFactory
+    {
+    public:
+        // io_uring不可用时返回pwrite引擎
+        static IoEngine::ptr Create(IoEngineType type = IO_ENGINE_URING)
+        {
+#ifdef LOG_MASTER_HAS_IO_URING
+            if (type == IO_ENGINE_URING)
+            {
+                std::shared_ptr<UringIoEngine> engine = std::make_shared<UringIoEngine>();
+                if (engine->ok())
+                {
+                    return engine;
+                }
+            }
+#endif
+            (void)type;
+            return std::make_shared<PwriteIoEngine>();
+        }
+    };
+
+    // 追加写入的日志文件：指定引擎时以显式偏移量写入(同一文件只能由一个LogFile写入)，否则使用ofstream
+    class LogFile
+    {
+    public:
+        LogFile(IoEngine::ptr engine = IoEngine::ptr()) : _engine(engine), _fd(-1), _sync_fd(-1), _offset(0) {}
+        ~LogFile() { close(); }
+        bool open(const std::string &pathname)
+        {
+            _pathname = pathname;
+            if (!_engine)
+            {
+                _ofs.open(pathname, std::ios::binary | std::ios::app);
+                return _ofs.is_open();
+            }
+            _fd = ::open(pathname.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+            if (_fd < 0)
+            {
+                return false;
+            }
+            _offset = lseek(_fd, 0, SEEK_END);
+            return true;
+        }
+        void write(const char *data, size_t len)
+        {
+            if (!_engine)
+            {
+                _ofs.write(data, len);
+                return;
+            }
+            _engine->write(_fd, data, len, _offset);
+            _offset += len;
+        }
+        // 等待异步写入完成，之后才能复用传给write的内存
+        void wait()
+        {
+            if (_engine)
+            {
+                _engine->wait();
+            }
+        }
+        // 刷盘：先等待(或冲刷ofstream缓冲的)写入，再fsync/fdatasync
+        bool sync(bool data_only)
+        {
+            int fd = _fd;
+            if (!_engine)
+            {
+                _ofs.flush();
+                if (_sync_fd < 0)
+                {
+                    _sync_fd = ::open(_pathname.c_str(), O_RDONLY | O_CLOEXEC);
+                }
+                fd = _sync_fd;
+            }
+            else
+            {
+                _engine->wait();
+            }
+            return fd >= 0 && IoEngine::Sync(fd, data_only);
+        }
+        // wait_io为false时调用方须已wait()(不再等待写入引擎上其他文件的写入)
+        void close(bool wait_io = true)
+        {
+            if (_sync_fd >= 0)
+            {
+                ::close(_sync_fd);
+                _sync_fd = -1;
+            }
+            if (!_engine)
+            {
+                _ofs.close();
+                return;
+            }
+            if (_fd >= 0)
+            {
+                if (wait_io)
+                {
+                    _engine->wait();
+                }
+                ::close(_fd);
+                _fd = -1;
+            }
+        }
+        bool good()
+        {
+            if (!_engine)
+            {
+                return _ofs.good();
+            }
+            return _fd >= 0 && !_engine->failed();
+        }
+        bool async() { return _engine && _engine->async(); }
+
+    private:
+        IoEngine::ptr _engine;
+        std::ofstream _ofs;
+        std::string _pathname;
+        int _fd;
+        int _sync_fd; // ofstream写入时用于刷盘的只读描述符(首次刷盘时打开)
+        off_t _offset;
+    };
+}
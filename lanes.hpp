@@ -0,0 +1,333 @@
+#pragma once
+/*异步日志器的落地方向写入通道(lane)，由LoggerBuilder::buildEnableSinkLanes开启：
+    1.每个落地方向一个写入线程，后台线程把一批数据交给各通道后立即返回，慢的落地方向(如被阻塞的标准输出管道)只在自己的通道上落后
+    2.同一批数据只复制一次(Batch)，由各通道按引用计数共享，最后一个通道写完后才回到BatchPool中复用
+    3.每个通道记录积压(已交给通道但尚未写完的字节数)；默认不设上限(不丢弃日志)，
+      显式设置上限时积压超过上限的通道跳过新的批次并计数，不影响其他落地方向，也不阻塞生产者；
+      设置了持久化策略的落地方向从不跳过(刷盘确认与Logger::flush()必须覆盖全部日志)，跳过的批次由Logger::flush()的返回值报告*/
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+#include "./buffer.hpp"
+#include "./logsink.hpp"
+#include "./stats.hpp"
+
+namespace log_master
+{
+    #define LANE_BATCH_SIZE 64*1024   // 新建批次缓冲区的初始大小
+    #define LANE_POOL_SIZE 4          // BatchPool中保留的空闲批次个数
+
+    class BatchPool;
+    // 一批只读数据，引用计数归零时回到BatchPool
+    class Batch
+    {
+    public:
+        Batch(BatchPool *pool) : _buffer(LANE_BATCH_SIZE), _refs(0), _pool(pool) {}
+        const char *data() { return _buffer.begin(); }
+        size_t size() { return _buffer.readAbleSize(); }
+        const IndexMark *marks() { return _marks.data(); }
+        size_t markCount() { return _marks.size(); }
+        inline void release();
+
+    private:
+        friend class BatchPool;
+        friend class SinkLanes;
+        Buffer _buffer;
+        std::vector<IndexMark> _marks; // 时间索引标记(见SinkRouter)
+        std::atomic<size_t> _refs;
+        BatchPool *_pool;
+    };
+
+    class BatchPool
+    {
+    public:
+        ~BatchPool()
+        {
+            for (auto b : _free)
+            {
+                delete b;
+            }
+        }
+        Batch *acquire(const char *data, size_t len, const IndexMark *marks, size_t n)
+        {
+            Batch *b = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (!_free.empty())
+                {
+                    b = _free.back();
+                    _free.pop_back();
+                }
+            }
+            if (b == nullptr)
+            {
+                b = new Batch(this);
+            }
+            b->_buffer.push(data, len);
+            b->_marks.assign(marks, marks + n);
+            return b;
+        }
+        void recycle(Batch *b)
+        {
+            b->_buffer.reset();
+            b->_marks.clear();
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_free.size() < LANE_POOL_SIZE)
+                {
+                    _free.push_back(b);
+                    return;
+                }
+            }
+            delete b;
+        }
+
+    private:
+        std::mutex _mutex;
+        std::vector<Batch *> _free;
+    };
+    inline void Batch::release()
+    {
+        if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            _pool->recycle(this);
+        }
+    }
+
+    // 一个落地方向的写入通道
+    class SinkLane
+    {
+    public:
+        SinkLane(const LogSink::ptr &sink, size_t max_lag)
+            : _sink(sink), _max_lag(sink->durability()._level == DURABILITY_NONE ? max_lag : 0), _stop(false), _busy(false), _busy_seq(0), _lag(0), _max_seen(0), _skipped(0), _skipped_bytes(0), _reported(0)
+        {
+            _thread = std::thread(&SinkLane::threadEntry, this);
+        }
+        // 写完已交给通道的全部批次后退出
+        ~SinkLane()
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _cond.notify_all();
+            _thread.join();
+        }
+        const LogSink::ptr &sink() { return _sink; }
+        // 交给通道一个引用(seq为批次序号)；设置了上限且积压超过上限时跳过(通道为空时总是接收)，返回false由调用方释放引用
+        bool push(Batch *b, uint64_t seq)
+        {
+            size_t len = b->size();
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_max_lag != 0 && _lag + len > _max_lag && !_queue.empty())
+                {
+                    _skipped++;
+                    _skipped_bytes += len;
+                    return false;
+                }
+                _queue.push_back(Entry{b, seq});
+                _lag += len;
+                _max_seen = std::max(_max_seen, _lag);
+            }
+            _cond.notify_one();
+            return true;
+        }
+        // 等待已交给通道的批次全部写完
+        void drain()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _idle.wait(lock, [this]()
+                       { return _queue.empty() && !_busy; });
+        }
+        // 等待序号不大于seq的批次写完
+        void waitFor(uint64_t seq)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _idle.wait(lock, [this, seq]()
+                       { return (_queue.empty() || _queue.front()._seq > seq) && (!_busy || _busy_seq > seq); });
+        }
+        // 上次调用以来是否跳过了批次
+        bool takeSkipped()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            bool skipped = _skipped != _reported;
+            _reported = _skipped;
+            return skipped;
+        }
+        void fill(SinkStats &st)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            st._lane = true;
+            st._lag_bytes = _lag;
+            st._max_lag_bytes = _max_seen;
+            st._skipped_batches = _skipped;
+            st._skipped_bytes = _skipped_bytes;
+        }
+
+    private:
+        // 按间隔刷盘的落地方向有未刷盘的写入时，空闲等待到期后由通道线程刷盘
+        void threadEntry()
+        {
+            bool interval = _sink->durability()._level == DURABILITY_INTERVAL;
+            uint64_t due = 0; // 距下次按间隔刷盘的纳秒数(0表示没有未刷盘的写入)
+            while (true)
+            {
+                Batch *b;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    auto ready = [this]()
+                    { return _stop || !_queue.empty(); };
+                    if (due == 0)
+                    {
+                        _cond.wait(lock, ready);
+                    }
+                    else if (!_cond.wait_for(lock, std::chrono::nanoseconds(due), ready))
+                    {
+                        lock.unlock();
+                        due = _sink->CommitDue();
+                        continue;
+                    }
+                    if (_queue.empty())
+                    {
+                        return;
+                    }
+                    b = _queue.front()._batch;
+                    _busy_seq = _queue.front()._seq;
+                    _queue.pop_front();
+                    _busy = true;
+                }
+                size_t len = b->size();
+                _sink->Write(b->data(), len, b->marks(), b->markCount());
+                _sink->Wait();
+                b->release();
+                due = interval ? _sink->CommitDue() : 0;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _lag -= len;
+                    _busy = false;
+                }
+                _idle.notify_all();
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            Batch *_batch;
+            uint64_t _seq;
+        };
+        LogSink::ptr _sink;
+        size_t _max_lag;
+        bool _stop;
+        bool _busy;     // 写入线程正在写一个批次
+        uint64_t _busy_seq;
+        uint64_t _lag;  // 积压的字节数(含正在写的批次)
+        uint64_t _max_seen;
+        uint64_t _skipped;
+        uint64_t _skipped_bytes;
+        uint64_t _reported; // 已由takeSkipped报告的跳过次数
+        std::deque<Entry> _queue;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::condition_variable _idle;
+        std::thread _thread;
+    };
+
+    // 一个日志器的全部写入通道(与日志器的落地方向一一对应，dispatch只在后台线程中调用)
+    class SinkLanes
+    {
+    public:
+        SinkLanes(const std::vector<LogSink::ptr> &logsinks, size_t max_lag) : _seq(0)
+        {
+            for (auto &e : logsinks)
+            {
+                _lanes.emplace_back(new SinkLane(e, max_lag));
+            }
+        }
+        // 将数据(及其时间索引标记)复制一次，交给want(落地方向)为true的各通道
+        template <typename Pred>
+        void dispatch(const char *data, size_t len, Pred want, const IndexMark *marks = nullptr, size_t n = 0)
+        {
+            if (len == 0)
+            {
+                return;
+            }
+            _targets.clear();
+            for (auto &l : _lanes)
+            {
+                if (want(l->sink()))
+                {
+                    _targets.push_back(l.get());
+                }
+            }
+            if (_targets.empty())
+            {
+                return;
+            }
+            Batch *b = _pool.acquire(data, len, marks, n);
+            b->_refs.store(_targets.size(), std::memory_order_relaxed);
+            uint64_t seq = _seq.load(std::memory_order_relaxed) + 1;
+            _seq.store(seq, std::memory_order_release);
+            for (auto l : _targets)
+            {
+                if (!l->push(b, seq))
+                {
+                    b->release();
+                }
+            }
+        }
+        void dispatch(const char *data, size_t len, const std::vector<LogSink::ptr> &sinks, const IndexMark *marks = nullptr, size_t n = 0)
+        {
+            dispatch(data, len, [&sinks](const LogSink::ptr &e)
+                     { return std::find(sinks.begin(), sinks.end(), e) != sinks.end(); }, marks, n);
+        }
+        void drain()
+        {
+            for (auto &l : _lanes)
+            {
+                l->drain();
+            }
+        }
+        // 等待调用前已交出的批次在各通道写完(可在任意线程调用，新的批次不影响返回)
+        void waitDispatched()
+        {
+            uint64_t seq = _seq.load(std::memory_order_acquire);
+            for (auto &l : _lanes)
+            {
+                l->waitFor(seq);
+            }
+        }
+        // 上次调用以来是否有通道跳过了批次
+        bool takeSkipped()
+        {
+            bool skipped = false;
+            for (auto &l : _lanes)
+            {
+                skipped = l->takeSkipped() || skipped;
+            }
+            return skipped;
+        }
+        // 补充各落地方向的积压指标(顺序与落地方向相同)
+        void fill(std::vector<SinkStats> &sinks)
+        {
+            for (size_t i = 0; i < _lanes.size() && i < sinks.size(); i++)
+            {
+                _lanes[i]->fill(sinks[i]);
+            }
+        }
+
+    private:
+        BatchPool _pool; // 先于通道构造、后于通道析构
+        std::vector<std::unique_ptr<SinkLane>> _lanes;
+        std::vector<SinkLane *> _targets;
+        std::atomic<uint64_t> _seq; // 已交出的批次数
+    };
+}
@@ -4,6 +4,16 @@
     提供把日志等级转换为相应字符串
 */
 #include <iostream>
+// 编译期日志等级：低于该等级的日志宏展开为空操作(如-DLOG_MASTER_ACTIVE_LEVEL=LOG_MASTER_LEVEL_INFO)
+#define LOG_MASTER_LEVEL_DEBUG 1
+#define LOG_MASTER_LEVEL_INFO 2
+#define LOG_MASTER_LEVEL_WARNING 3
+#define LOG_MASTER_LEVEL_ERROR 4
+#define LOG_MASTER_LEVEL_FATAL 5
+#define LOG_MASTER_LEVEL_OFF 6
+#ifndef LOG_MASTER_ACTIVE_LEVEL
+#define LOG_MASTER_ACTIVE_LEVEL LOG_MASTER_LEVEL_DEBUG
+#endif
 namespace log_master
 {
     class Log_level
@@ -39,5 +49,25 @@ namespace log_master
             }
             return "UNKNOW";
         }
+        // 返回静态字符串，格式化热路径上不构造std::string
+        static const char *ToCString(Log_level::level level)
+        {
+            switch (level)
+            {
+            case level::DEBUG:
+                return "DEBUG";
+            case level::INFO:
+                return "INFO";
+            case level::WARNING:
+                return "WARNING";
+            case level::ERROR:
+                return "ERROR";
+            case level::FATAL:
+                return "FATAL";
+            case level::OFF:
+                return "OFF";
+            }
+            return "UNKNOW";
+        }
     };
 }
\ No newline at end of file
@@ -8,6 +8,12 @@
 #include "./message.hpp"
 #include "./format.hpp"
 #include "./looper.hpp"
+#include "./fmtstr.hpp"
+#include "./binlog.hpp"
+#include "./stats.hpp"
+#include "./structured.hpp"
+#include "./ratelimit.hpp"
+#include "./lanes.hpp"
 
 #include <atomic>
 #include <mutex>
@@ -22,140 +28,333 @@ namespace log_master
     {
     public:
         using ptr = std::shared_ptr<Logger>;
-        Logger() {}
+        Logger() : _commit_timer(0) {}
         Logger(Log_level::level limit_level,
                Formatter::ptr formatter,
                const std::string &logger_name,
-               std::vector<LogSink::ptr> logsinks) : _limit_level(limit_level), _formatter(formatter), _logger_name(logger_name), _logsinks(logsinks.begin(), logsinks.end()) {}
+               std::vector<LogSink::ptr> logsinks,
+               Util::ClockSource clock = Util::CLOCK_SRC_REALTIME) : _limit_level(limit_level), _formatter(formatter), _logger_name(logger_name), _logsinks(logsinks.begin(), logsinks.end()), _clock(clock),
+                                                                     _router(formatter, _logsinks, limit_level), _routed(_router.routed()), _commit_timer(0)
+        {
+            // 低于所有落地方向等级的日志在调用处直接返回；所有文本落地方向格式与等级相同时按原方式只格式化一次
+            _limit_level = _router.minLevel();
+            if (!_routed && _router.formatter())
+            {
+                _formatter = _router.formatter();
+            }
+            if (_clock == Util::CLOCK_SRC_TSC)
+            {
+                Util::TscClock::getInstance(); // 提前完成初次校准，避免落在首条日志上
+            }
+        }
         //    protected:
         const std::string &name()
         {
             return _logger_name;
         }
+        // 该等级的日志是否会被输出
+        bool Enabled(Log_level::level level)
+        {
+            return level >= _limit_level.load(std::memory_order_relaxed);
+        }
+        // 等级满足时才调用f(由bitlog.h中的宏使用，参数在f中求值)
+        template <typename F>
+        void LogIf(Log_level::level level, F f)
+        {
+            if (Enabled(level))
+            {
+                f(*this);
+                return;
+            }
+            _filtered.add();
+        }
+        // 被LOG_MASTER_ACTIVE_LEVEL裁剪的日志宏
+        void LogNothing() {}
+        // 被调用点的限流/采样拒绝(由bitlog.h中的xxx_limited/xxx_sampled宏调用)
+        void Suppress() { _suppressed.add(); }
+        // 屏障：返回时此前写入的日志都已写出并刷盘(不论落地方向的持久化策略)；
+        //  返回false表示自上次flush()以来有批次被写入通道按积压上限跳过，这些日志没有写出
+        virtual bool flush() = 0;
+        // 运行指标快照
+        LoggerStats stats()
+        {
+            LoggerStats st;
+            st._name = _logger_name;
+            st._accepted = _accepted.load();
+            st._filtered = _filtered.load();
+            st._suppressed = _suppressed.load();
+            for (auto &e : _logsinks)
+            {
+                st._sinks.push_back(e->stats());
+            }
+            fillStats(st);
+            return st;
+        }
         /*完成构造日志消息对象并进行格式化，得到格式化后的日志消息字符串，然后落地输出*/
-        void Debug(const std::string &file, const size_t line, const std::string &fmt, ...)
+        void Debug(const char *file, const size_t line, const char *fmt, ...)
         {
             // 通过传入的参数构造出一个日志消息对象，进行日志的格式化，最终落地
             // 1.判断当前的日志是否达到了输出等级
-            if (Log_level::DEBUG < _limit_level)
+            if (!admit(Log_level::DEBUG))
             {
                 return;
             }
-            // 2.对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+            // 2.对fmt格式化字符串和不定参进行字符串组织，有效载荷写入栈上缓冲区(超出后转存到线程局部缓冲区)
+            FmtStr::Writer writer;
             va_list va;
             va_start(va, fmt);
-            char *str;
-            int ret = vasprintf(&str, fmt.c_str(), va);
-            if (ret == -1)
+            bool ok = writer.vprintf(fmt, va);
+            va_end(va);
+            if (!ok)
             {
-                std::cout << "vasprintf failed!!" << std::endl;
+                std::cout << "vsnprintf failed!!" << std::endl;
+                return;
             }
-            // 3.构造LogMsg对象
-            Message::LogMsg msg(Log_level::DEBUG, line, file, _logger_name, str);
-            // 4.通过格式化工具对LogMsg进行格式化，得到格式化后的日志字符串
-            std::stringstream ss;
-            _formatter->Format(ss, msg);
-            // 5.进行日志落地
-            log(ss.str(), ss.str().size());
+            // 3.构造LogMsg对象，格式化后落地
+            Message::LogMsg msg(Log_level::DEBUG, line, file, _logger_name, Message::StrView(writer.data(), writer.size()), Util::Clock::Now(_clock));
+            serialize(msg);
         }
-        void Info(const std::string &file, const size_t line, const std::string &fmt, ...)
+        void Info(const char *file, const size_t line, const char *fmt, ...)
         { // 1.判断当前的日志是否达到了输出等级
-            if (Log_level::INFO < _limit_level)
+            if (!admit(Log_level::INFO))
             {
                 return;
             }
-            // 2.对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+            // 2.对fmt格式化字符串和不定参进行字符串组织，有效载荷写入栈上缓冲区(超出后转存到线程局部缓冲区)
+            FmtStr::Writer writer;
             va_list va;
             va_start(va, fmt);
-            char *str;
-            int ret = vasprintf(&str, fmt.c_str(), va);
-            if (ret == -1)
+            bool ok = writer.vprintf(fmt, va);
+            va_end(va);
+            if (!ok)
             {
-                std::cout << "vasprintf failed!!" << std::endl;
+                std::cout << "vsnprintf failed!!" << std::endl;
+                return;
             }
-            // 3.构造LogMsg对象
-            Message::LogMsg msg(Log_level::INFO, line, file, _logger_name, str);
-            // 4.通过格式化工具对LogMsg进行格式化，得到格式化后的日志字符串
-            std::stringstream ss;
-            _formatter->Format(ss, msg);
-            // 5.进行日志落地
-            log(ss.str(), ss.str().size());
+            // 3.构造LogMsg对象，格式化后落地
+            Message::LogMsg msg(Log_level::INFO, line, file, _logger_name, Message::StrView(writer.data(), writer.size()), Util::Clock::Now(_clock));
+            serialize(msg);
         }
-        void Warning(const std::string &file, const size_t line, const std::string &fmt, ...)
+        void Warning(const char *file, const size_t line, const char *fmt, ...)
         {
             // 1.判断当前的日志是否达到了输出等级
-            if (Log_level::WARNING < _limit_level)
+            if (!admit(Log_level::WARNING))
             {
                 return;
             }
-            // 2.对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+            // 2.对fmt格式化字符串和不定参进行字符串组织，有效载荷写入栈上缓冲区(超出后转存到线程局部缓冲区)
+            FmtStr::Writer writer;
             va_list va;
             va_start(va, fmt);
-            char *str;
-            int ret = vasprintf(&str, fmt.c_str(), va);
-            if (ret == -1)
+            bool ok = writer.vprintf(fmt, va);
+            va_end(va);
+            if (!ok)
             {
-                std::cout << "vasprintf failed!!" << std::endl;
+                std::cout << "vsnprintf failed!!" << std::endl;
+                return;
             }
-            // 3.构造LogMsg对象
-            Message::LogMsg msg(Log_level::WARNING, line, file, _logger_name, str);
-            // 4.通过格式化工具对LogMsg进行格式化，得到格式化后的日志字符串
-            std::stringstream ss;
-            _formatter->Format(ss, msg);
-            // 5.进行日志落地
-            log(ss.str(), ss.str().size());
+            // 3.构造LogMsg对象，格式化后落地
+            Message::LogMsg msg(Log_level::WARNING, line, file, _logger_name, Message::StrView(writer.data(), writer.size()), Util::Clock::Now(_clock));
+            serialize(msg);
         }
 
-        void Error(const std::string &file, const size_t line, const std::string &fmt, ...)
+        void Error(const char *file, const size_t line, const char *fmt, ...)
         { // 1.判断当前的日志是否达到了输出等级
-            if (Log_level::ERROR < _limit_level)
+            if (!admit(Log_level::ERROR))
             {
                 return;
             }
-            // 2.对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+            // 2.对fmt格式化字符串和不定参进行字符串组织，有效载荷写入栈上缓冲区(超出后转存到线程局部缓冲区)
+            FmtStr::Writer writer;
             va_list va;
             va_start(va, fmt);
-            char *str;
-            int ret = vasprintf(&str, fmt.c_str(), va);
-            if (ret == -1)
+            bool ok = writer.vprintf(fmt, va);
+            va_end(va);
+            if (!ok)
             {
-                std::cout << "vasprintf failed!!" << std::endl;
+                std::cout << "vsnprintf failed!!" << std::endl;
+                return;
             }
-            // 3.构造LogMsg对象
-            Message::LogMsg msg(Log_level::ERROR, line, file, _logger_name, str);
-            // 4.通过格式化工具对LogMsg进行格式化，得到格式化后的日志字符串
-            std::stringstream ss;
-            _formatter->Format(ss, msg);
-            // 5.进行日志落地
-            log(ss.str(), ss.str().size());
+            // 3.构造LogMsg对象，格式化后落地
+            Message::LogMsg msg(Log_level::ERROR, line, file, _logger_name, Message::StrView(writer.data(), writer.size()), Util::Clock::Now(_clock));
+            serialize(msg);
         }
-        void Fatal(const std::string &file, const size_t line, const std::string &fmt, ...)
+        void Fatal(const char *file, const size_t line, const char *fmt, ...)
         { // 1.判断当前的日志是否达到了输出等级
-            if (Log_level::FATAL < _limit_level)
+            if (!admit(Log_level::FATAL))
             {
                 return;
             }
-            // 2.对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+            // 2.对fmt格式化字符串和不定参进行字符串组织，有效载荷写入栈上缓冲区(超出后转存到线程局部缓冲区)
+            FmtStr::Writer writer;
             va_list va;
             va_start(va, fmt);
-            char *str;
-            int ret = vasprintf(&str, fmt.c_str(), va);
-            if (ret == -1)
+            bool ok = writer.vprintf(fmt, va);
+            va_end(va);
+            if (!ok)
             {
-                std::cout << "vasprintf failed!!" << std::endl;
+                std::cout << "vsnprintf failed!!" << std::endl;
+                return;
             }
-            // 3.构造LogMsg对象
-            Message::LogMsg msg(Log_level::FATAL, line, file, _logger_name, str);
-            // 4.通过格式化工具对LogMsg进行格式化，得到格式化后的日志字符串
-            std::stringstream ss;
-            _formatter->Format(ss, msg);
-            // 5.进行日志落地
-            log(ss.str(), ss.str().size());
+            // 3.构造LogMsg对象，格式化后落地
+            Message::LogMsg msg(Log_level::FATAL, line, file, _logger_name, Message::StrView(writer.data(), writer.size()), Util::Clock::Now(_clock));
+            serialize(msg);
+        }
+
+        /*{}风格的格式化接口：占位符与参数数量在编译期校验(通过bitlog.h中的xxx_fmt宏调用)，
+          有效载荷直接格式化到栈上缓冲区，不经过vasprintf*/
+        template <bool OK, typename... Args>
+        void LogFmt(FmtStr::Checked<OK>, Log_level::level level, const char *file, size_t line, const char *fmt, const Args &...args)
+        {
+            static_assert(OK, "log_master: 格式化字符串中{}占位符数量与参数数量不一致");
+            if (!admit(level))
+            {
+                return;
+            }
+            FmtStr::Writer writer;
+            FmtStr::Format(writer, fmt, args...);
+            Message::LogMsg msg(level, line, file, _logger_name, Message::StrView(writer.data(), writer.size()), Util::Clock::Now(_clock));
+            serialize(msg);
+        }
+
+        /*结构化接口(通过bitlog.h中的xxx_kv宏调用)：日志消息之外携带log_master::kv()构造的键值对，
+          字段按类型编码后随LogMsg传递，由JSON/logfmt格式化器直接写出(普通格式追加在消息之后)*/
+        template <typename... Fields>
+        void LogKV(Log_level::level level, const char *file, size_t line, Message::StrView message, const Fields &...fields)
+        {
+            if (!admit(level))
+            {
+                return;
+            }
+            FmtStr::Writer writer;
+            Structured::EncodeFields(writer, fields...);
+            Message::LogMsg msg(level, line, file, _logger_name, message, Util::Clock::Now(_clock));
+            msg._fields = Message::StrView(writer.data(), writer.size());
+            serialize(msg);
+        }
+
+        /*延迟格式化接口(通过bitlog.h中的xxx_bin宏调用)：只记录调用点id与原始参数，
+          由logRecord决定立即还原(默认)或交给后台线程还原*/
+        template <typename... Args>
+        void LogBinary(const BinLog::CallSite &site, const Args &...args)
+        {
+            if (!admit(site._level))
+            {
+                return;
+            }
+            FmtStr::Writer writer;
+            BinLog::EncodeRecord(writer, site, Util::Clock::Now(_clock), args...);
+            logRecord(writer.data(), writer.size(), site._level);
         }
 
     protected:
+        // 等级检查并计数(被过滤的日志只对本线程的计数区做一次读与写，没有原子读改写)
+        bool admit(Log_level::level level)
+        {
+            if (level < _limit_level.load(std::memory_order_relaxed))
+            {
+                _filtered.add();
+                return false;
+            }
+            _accepted.add();
+            return true;
+        }
+        virtual void fillStats(LoggerStats &) {}
+        // 日志器析构时刷盘设置了持久化策略的落地方向(如按间隔刷盘时末尾的日志)
+        void commitDurable()
+        {
+            for (auto &e : _logsinks)
+            {
+                if (e->durability()._level != DURABILITY_NONE)
+                {
+                    e->Commit(false);
+                }
+            }
+        }
+        // 存在按间隔刷盘的落地方向时向定时器注册，写入停止后由定时器刷盘(派生类构造完成后调用，析构开始时注销)
+        void startIntervalCommit()
+        {
+            uint32_t interval = 0;
+            for (auto &e : _logsinks)
+            {
+                const Durability &d = e->durability();
+                if (d._level == DURABILITY_INTERVAL && (interval == 0 || d._interval_ms < interval))
+                {
+                    interval = d._interval_ms;
+                }
+            }
+            // 每半个间隔检查一次，写入停止后最迟约1.5个间隔刷盘
+            if (interval != 0)
+            {
+                _commit_timer = DurabilityTimer::getInstance().add(interval / 2, [this]()
+                                                                   { commitDue(); });
+            }
+        }
+        void stopIntervalCommit()
+        {
+            if (_commit_timer != 0)
+            {
+                DurabilityTimer::getInstance().remove(_commit_timer);
+                _commit_timer = 0;
+            }
+        }
+        // 刷盘到期的按间隔刷盘落地方向(_mutex与写入互斥)
+        void commitDue()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            for (auto &e : _logsinks)
+            {
+                if (e->durability()._level == DURABILITY_INTERVAL)
+                {
+                    e->CommitDue();
+                }
+            }
+        }
         /*抽象接口完成实际的落地输出--不同的日志器有不同的实际落地方式*/
-        virtual void log(const std::string &data, size_t len) = 0;
+        virtual void log(const std::string &data, size_t len, Log_level::level level) = 0;
+        // 默认在调用线程中立即还原二进制记录并落地(解码器线程局部复用，还原缓冲区的容量保留)
+        virtual void logRecord(const char *data, size_t len, Log_level::level)
+        {
+            BinLog::Decoder &decoder = RecordDecoder();
+            decoder.setName(_logger_name);
+            decoder.Decode(data, len, [this](Message::LogMsg &msg)
+                           { serialize(msg); }, [](const char *, size_t) {});
+        }
+        // 落地方向的等级或格式不同时按落地方向分发LogMsg
+        virtual void logMsg(Message::LogMsg &msg) = 0;
+        // 将LogMsg格式化到线程局部缓冲区(容量复用)后落地
+        void serialize(Message::LogMsg &msg)
+        {
+            // 限流/采样放行的日志附带此前被拒绝的条数
+            uint64_t &suppressed = RateLimit::Pending::Count();
+            FmtStr::Writer fields;
+            if (suppressed != 0)
+            {
+                fields.append(msg._fields.data(), msg._fields.size());
+                Structured::EncodeField(fields, "suppressed", suppressed);
+                msg._fields = Message::StrView(fields.data(), fields.size());
+                suppressed = 0;
+            }
+            if (_routed)
+            {
+                logMsg(msg);
+                return;
+            }
+            std::string &buf = FormatBuffer();
+            buf.clear();
+            _formatter->Format(buf, msg);
+            log(buf, buf.size(), msg._level);
+        }
+        static std::string &FormatBuffer()
+        {
+            static thread_local std::string buf;
+            return buf;
+        }
+        static BinLog::Decoder &RecordDecoder()
+        {
+            static thread_local BinLog::Decoder decoder("");
+            return decoder;
+        }
 
     protected:
         std::mutex _mutex;
@@ -163,28 +362,144 @@ namespace log_master
         Formatter::ptr _formatter;
         std::string _logger_name;
         std::vector<LogSink::ptr> _logsinks;
+        Util::ClockSource _clock; // 日志时间戳的时钟源
+        SinkRouter _router;       // 按落地方向的等级与格式分发(同步日志器在锁内使用，异步日志器仅后台线程使用)
+        bool _routed;             // 是否存在等级或格式不同的文本落地方向
+        Stats::StripedCounter _accepted;
+        Stats::ThreadCounter _filtered;
+        Stats::StripedCounter _suppressed;
+        size_t _commit_timer; // 按间隔刷盘的定时器任务(0表示未注册)
     };
+    // 同步日志器：默认每条日志在_mutex内写入全部落地方向；
+    //  合并写入模式(buildEnableSyncCombining)下调用线程只在短暂的_combine_mutex内排队，
+    //  排队时没有写入者的线程成为合并者：取走全部排队的记录，拼接后每个落地方向只写一次，再唤醒各线程返回。
+    //  写入期间新到达的线程继续排队，由下一个合并者一并写出，多线程时写入次数随线程数减少而不是互相等待
     class SyncLogger : public Logger
     {
     public:
         SyncLogger(Log_level::level limit_level,
                    Formatter::ptr formatter,
                    const std::string &logger_name,
-                   std::vector<LogSink::ptr> &logsinks) : Logger(limit_level, formatter, logger_name, logsinks) {}
+                   std::vector<LogSink::ptr> &logsinks,
+                   Util::ClockSource clock = Util::CLOCK_SRC_REALTIME,
+                   bool combining = false) : Logger(limit_level, formatter, logger_name, logsinks, clock), _combining(combining), _writing(false)
+        {
+            startIntervalCommit();
+        }
+        ~SyncLogger()
+        {
+            stopIntervalCommit();
+            commitDurable();
+        }
 
     protected:
-        void log(const std::string &data, size_t len) override
+        void log(const std::string &data, size_t len, Log_level::level) override
         {
-            std::unique_lock<std::mutex> lock(_mutex);
             if (_logsinks.empty())
             {
                 return;
             }
+            if (_combining)
+            {
+                logCombined(data.c_str(), len);
+                return;
+            }
+            std::unique_lock<std::mutex> lock(_mutex);
+            writeAll(data.c_str(), len);
+        }
+        bool flush() override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            for (auto &e : _logsinks)
+            {
+                e->Commit(false);
+            }
+            return true;
+        }
+        void logMsg(Message::LogMsg &msg) override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _router.clear();
+            _router.route(msg);
+            _router.flush();
+            for (auto &e : _logsinks)
+            {
+                e->Wait();
+            }
+        }
+
+    private:
+        // 一条等待写入的记录(位于调用线程的栈上，写完前调用线程不返回)
+        struct Pending
+        {
+            const char *_data;
+            size_t _len;
+            bool _done;
+        };
+        void writeAll(const char *data, size_t len)
+        {
             for (auto &e : _logsinks)
             {
-                e->Log(data, len);
+                e->Write(data, len);
+            }
+            // 各落地方向的异步写入并行进行，返回前等待全部完成
+            for (auto &e : _logsinks)
+            {
+                e->Wait();
+            }
+        }
+        void logCombined(const char *data, size_t len)
+        {
+            Pending self{data, len, false};
+            std::unique_lock<std::mutex> lock(_combine_mutex);
+            _queue.push_back(&self);
+            while (!self._done)
+            {
+                if (_writing)
+                {
+                    _combine_cond.wait(lock);
+                    continue;
+                }
+                // 成为合并者：取走当前排队的全部记录
+                _writing = true;
+                _batch.swap(_queue);
+                lock.unlock();
+                {
+                    // _mutex与路由写入(logMsg)互斥
+                    std::unique_lock<std::mutex> sink_lock(_mutex);
+                    if (_batch.size() == 1)
+                    {
+                        writeAll(_batch[0]->_data, _batch[0]->_len);
+                    }
+                    else
+                    {
+                        _combined.clear();
+                        for (auto p : _batch)
+                        {
+                            _combined.append(p->_data, p->_len);
+                        }
+                        writeAll(_combined.data(), _combined.size());
+                    }
+                }
+                lock.lock();
+                for (auto p : _batch)
+                {
+                    p->_done = true;
+                }
+                _batch.clear();
+                _writing = false;
+                _combine_cond.notify_all();
             }
         }
+
+    private:
+        bool _combining;                 // 是否合并写入
+        bool _writing;                   // 是否有合并者正在写入(以下成员受_combine_mutex保护，_batch与_combined只由合并者使用)
+        std::vector<Pending *> _queue;   // 排队的记录
+        std::vector<Pending *> _batch;   // 合并者取走的记录
+        std::string _combined;           // 拼接后的记录
+        std::mutex _combine_mutex;
+        std::condition_variable _combine_cond;
     };
     class AsyncLogger : public Logger
     {
@@ -193,34 +508,447 @@ namespace log_master
                     Formatter::ptr formatter,
                     const std::string &logger_name,
                     std::vector<LogSink::ptr> &logsinks,
-                    AsyncLooper::AsyncType looper_type) : Logger(limit_level, formatter, logger_name, logsinks),
-                                                          _looper(std::make_shared<AsyncLooper>(std::bind(&AsyncLogger::realLog, this, std::placeholders::_1), looper_type)) {}
+                    AsyncLooper::AsyncType looper_type,
+                    LooperEngine looper_engine = LOOPER_DOUBLE_BUFFER,
+                    bool deferred = false,
+                    Util::ClockSource clock = Util::CLOCK_SRC_REALTIME,
+                    BackendPool::ptr backend = BackendPool::ptr(),
+                    const OverflowPolicy &policy = OverflowPolicy(),
+                    bool lanes = false,
+                    size_t lane_lag = 0) : Logger(limit_level, formatter, logger_name, logsinks, clock),
+                                             _deferred(deferred),
+                                             _framed(deferred || _routed),
+                                             _ack(HasSyncDurability(logsinks)),
+                                             _decoder(logger_name),
+                                             _reported_dropped(0),
+                                             _last_report(0),
+                                             _inflight(!lanes && HasAsyncIo(logsinks) ? new Buffer() : nullptr),
+                                             _lanes(lanes ? new SinkLanes(logsinks, lane_lag) : nullptr),
+                                             _looper(LooperFactory::Create(looper_engine, std::bind(&AsyncLogger::realLog, this, std::placeholders::_1), looper_type, policy, backend))
+        {
+            if (_deferred)
+            {
+                // 二进制文件中记录日志器名称，供离线解码
+                FmtStr::Writer writer;
+                BinLog::EncodeText(writer, BinLog::FRAME_NAME, _logger_name.c_str(), _logger_name.size());
+                _looper->push(writer.data(), writer.size(), Log_level::OFF);
+            }
+            // 开启写入通道时由各通道线程在空闲时按间隔刷盘
+            if (!_lanes)
+            {
+                startIntervalCommit();
+            }
+        }
+        ~AsyncLogger()
+        {
+            stopIntervalCommit();
+            _looper->stop();
+            if (_lanes)
+            {
+                _lanes->drain();
+            }
+            for (auto &e : _logsinks)
+            {
+                e->Wait();
+            }
+            _router.clear();
+            reportDropped(true);
+            if (_framed)
+            {
+                flushRouter();
+            }
+            // 写入通道析构时写完剩余的批次
+            _lanes.reset();
+            for (auto &e : _logsinks)
+            {
+                e->Wait();
+            }
+            commitDurable();
+        }
         // 将日志写入缓冲区
-        void log(const std::string &data, size_t len) override
+        void log(const std::string &data, size_t len, Log_level::level level) override
         {
-
-            _looper->push(data, len);
+            if (_framed)
+            {
+                // 延迟格式化模式下缓冲区中只有帧，已格式化的文本也要封装成帧
+                FmtStr::Writer writer;
+                BinLog::EncodeText(writer, BinLog::FRAME_TEXT, data.c_str(), len);
+                _looper->push(writer.data(), writer.size(), level);
+            }
+            else
+            {
+                _looper->push(data.c_str(), len, level);
+            }
+            acknowledge();
+        }
+        // 等待此前的日志交给后台线程写出，再与后台线程互斥地刷盘全部落地方向
+        bool flush() override
+        {
+            _looper->flush();
+            std::unique_lock<std::mutex> lock(_mutex);
+            bool complete = true;
+            if (_lanes)
+            {
+                _lanes->drain();
+                complete = !_lanes->takeSkipped();
+            }
+            for (auto &e : _logsinks)
+            {
+                e->Commit(false);
+            }
+            return complete;
         }
-        // 实际落地函数
+        // 实际落地函数(_mutex与flush()互斥)
         void realLog(Buffer &buffer)
         {
+            std::unique_lock<std::mutex> lock(_mutex);
 
             if (_logsinks.empty())
             {
                 return;
             }
-            if (!_logsinks.empty())
+            Buffer *batch = &buffer;
+            if (_inflight)
+            {
+                // 异步写入：等待上一批写入完成后将其内存交还给工作器，
+                // 本批数据留在_inflight中直到下一批到来，期间工作器继续收集日志
+                for (auto &e : _logsinks)
+                {
+                    e->Wait();
+                }
+                _inflight->reset();
+                _inflight->swap(buffer);
+                batch = _inflight.get();
+            }
+            if (_framed)
+            {
+                realLogDeferred(*batch);
+                return;
+            }
+            if (_lanes)
+            {
+                _lanes->dispatch(batch->begin(), batch->readAbleSize(), [](const LogSink::ptr &)
+                                 { return true; });
+            }
+            else
+            {
+                for (auto &e : _logsinks)
+                {
+                    e->Write(batch->begin(), batch->readAbleSize());
+                }
+            }
+            reportDropped(false);
+        }
+
+    protected:
+        void fillStats(LoggerStats &st) override
+        {
+            st._async = true;
+            st._looper = _looper->stats();
+            if (_lanes)
+            {
+                _lanes->fill(st._sinks);
+            }
+        }
+        // 延迟格式化模式下直接将原始记录放入缓冲区
+        void logRecord(const char *data, size_t len, Log_level::level level) override
+        {
+            if (!_deferred)
+            {
+                Logger::logRecord(data, len, level);
+                return;
+            }
+            _looper->push(data, len, level);
+            acknowledge();
+        }
+        // 落地方向的等级或格式不同时不在调用线程格式化，将LogMsg封装成帧交给后台线程分发
+        void logMsg(Message::LogMsg &msg) override
+        {
+            FmtStr::Writer writer;
+            BinLog::EncodeMsg(writer, msg);
+            _looper->push(writer.data(), writer.size(), msg._level);
+            acknowledge();
+        }
+
+    private:
+        // 溢出策略丢弃了日志时，每隔DROP_REPORT_INTERVAL秒(及析构时)输出一条"N messages dropped"记录
+        //  帧模式下文本落地方向的记录交给_router，随本批文本一起写出
+        void reportDropped(bool force)
+        {
+            uint64_t dropped = _looper->dropped();
+            if (dropped == _reported_dropped)
+            {
+                return;
+            }
+            time_t now = Util::Date::getTime();
+            if (!force && now - _last_report < DROP_REPORT_INTERVAL)
+            {
+                return;
+            }
+            std::string payload = std::to_string(dropped - _reported_dropped) + " messages dropped by overflow policy";
+            Message::LogMsg msg(Log_level::WARNING, __LINE__, __FILE__, _logger_name, payload);
+            _reported_dropped = dropped;
+            _last_report = now;
+            _report.clear();
+            _formatter->Format(_report, msg);
+            if (_framed)
+            {
+                _router.route(msg);
+            }
+            for (auto &e : _logsinks)
+            {
+                if (_framed && !e->IsBinary())
+                {
+                    continue;
+                }
+                if (e->IsBinary())
+                {
+                    FmtStr::Writer writer;
+                    BinLog::EncodeText(writer, BinLog::FRAME_TEXT, _report.data(), _report.size());
+                    _report_frame.assign(writer.data(), writer.size());
+                    writeSink(e, _report_frame.data(), _report_frame.size());
+                    continue;
+                }
+                writeSink(e, _report.data(), _report.size());
+            }
+        }
+        // 写入一个落地方向(开启写入通道时交给它的通道)
+        void writeSink(const LogSink::ptr &e, const char *data, size_t len)
+        {
+            if (_lanes)
+            {
+                _lanes->dispatch(data, len, [&e](const LogSink::ptr &x)
+                                 { return x == e; });
+                return;
+            }
+            e->Write(data, len);
+        }
+        // 写出_router中各分组的文本(开启写入通道时每组复制一次，由该组的各通道共享)
+        void flushRouter()
+        {
+            if (!_lanes)
+            {
+                _router.flush();
+                return;
+            }
+            _router.flush([this](const std::string &text, const std::vector<IndexMark> &marks, const std::vector<LogSink::ptr> &sinks)
+                          { _lanes->dispatch(text.data(), text.size(), sinks, marks.data(), marks.size()); });
+        }
+        // 存在DURABILITY_SYNC的落地方向时，等待本条所在的批次写出并刷盘后才返回；
+        //  同时等待的生产者由后台线程的同一次写入与刷盘确认
+        void acknowledge()
+        {
+            if (!_ack)
+            {
+                return;
+            }
+            _looper->flush();
+            if (_lanes)
+            {
+                _lanes->waitDispatched();
+            }
+        }
+        static bool HasSyncDurability(std::vector<LogSink::ptr> &logsinks)
+        {
+            for (auto &e : logsinks)
+            {
+                if (e->durability()._level == DURABILITY_SYNC)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        static bool HasAsyncIo(std::vector<LogSink::ptr> &logsinks)
+        {
+            for (auto &e : logsinks)
+            {
+                if (e->IsAsyncIo())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        // 后台线程还原日志：二进制落地方向写原始帧，其余落地方向由_router按各自的等级与格式写出文本
+        void realLogDeferred(Buffer &buffer)
+        {
+            _router.clear();
+            _decoder.Decode(buffer.begin(), buffer.readAbleSize(), [this](Message::LogMsg &msg)
+                            { _router.route(msg); }, [this](const char *data, size_t len)
+                            { _router.routeText(data, len); });
+            if (_lanes)
+            {
+                _lanes->dispatch(buffer.begin(), buffer.readAbleSize(), [](const LogSink::ptr &e)
+                                 { return e->IsBinary(); });
+            }
+            else
             {
                 for (auto &e : _logsinks)
                 {
-                    e->Log(buffer.begin(), buffer.readAbleSize());
+                    if (e->IsBinary())
+                    {
+                        e->Write(buffer.begin(), buffer.readAbleSize());
+                    }
                 }
             }
+            reportDropped(false);
+            flushRouter();
         }
 
     private:
+        bool _deferred;           // 是否延迟格式化(后台线程还原二进制记录)
+        bool _framed;             // 缓冲区中是否为帧(延迟格式化或需要按落地方向分发)
+        bool _ack;                // 日志调用是否等待刷盘确认
+        BinLog::Decoder _decoder; // 仅后台线程使用
+        uint64_t _reported_dropped; // 已报告的丢弃条数(仅后台线程使用)
+        time_t _last_report;        // 上次报告丢弃条数的时间
+        std::string _report;        // 丢弃报告(异步写入时保留到下一批)
+        std::string _report_frame;
+        std::unique_ptr<Buffer> _inflight; // 异步写入中的批次(仅存在异步写入的落地方向且未开启写入通道时分配)
+        std::unique_ptr<SinkLanes> _lanes; // 各落地方向的写入通道(buildEnableSinkLanes开启)
         AsyncLooper::ptr _looper;
     };
+    // 全局单例管理器
+    //  日志器表是只读快照：查找只有一次acquire读取加哈希查找(无锁、无等待)；
+    //  注册时在锁内复制当前快照、插入后整体替换。日志器通常在启动时注册且不会被移除，
+    //  旧快照保留到进程退出(个数等于注册次数)，读者无需任何回收协议
+    class LoggerManager
+    {
+    public:
+        using LoggerMap = std::unordered_map<std::string, Logger::ptr>;
+        static LoggerManager &getInstance()
+        {
+            static LoggerManager eton;
+            return eton;
+        }
+        bool hasLogger(const std::string &name)
+        {
+            const LoggerMap *loggers = _loggers.load(std::memory_order_acquire);
+            return loggers->find(name) != loggers->end();
+        }
+        // 同名日志器已存在时不替换，返回false(检查与插入在同一把锁内完成)
+        bool addLogger(const Logger::ptr &logger)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            const LoggerMap *cur = _loggers.load(std::memory_order_relaxed);
+            if (cur->find(logger->name()) != cur->end())
+            {
+                return false;
+            }
+            std::unique_ptr<LoggerMap> next(new LoggerMap(*cur));
+            next->insert({logger->name(), logger});
+            _loggers.store(next.get(), std::memory_order_release);
+            _snapshots.push_back(std::move(next));
+            return true;
+        }
+        Logger::ptr getLogger(const std::string &name)
+        {
+            const LoggerMap *loggers = _loggers.load(std::memory_order_acquire);
+            auto it = loggers->find(name);
+            if (it == loggers->end())
+            {
+                return Logger::ptr();
+            }
+            return it->second;
+        }
+        // 默认日志器在构造时创建且不会改变，返回引用避免引用计数的原子操作
+        const Logger::ptr &rootLogger()
+        {
+            return _root_logger;
+        }
+        // 所有日志器的运行指标快照
+        std::vector<LoggerStats> stats()
+        {
+            std::vector<LoggerStats> st;
+            for (auto &e : *_loggers.load(std::memory_order_acquire))
+            {
+                st.push_back(e.second->stats());
+            }
+            return st;
+        }
+        // 每隔interval秒通过名为target的日志器为每个日志器输出一条INFO级的指标摘要(interval为0时关闭)
+        void enableStatsReport(size_t interval, const std::string &target = "root")
+        {
+            stopStatsReport();
+            if (interval == 0)
+            {
+                return;
+            }
+            std::unique_lock<std::mutex> lock(_report_mutex);
+            _report_stop = false;
+            _report_thread = std::thread(&LoggerManager::statsReportEntry, this, interval, target);
+        }
+
+        // 设置共享后台线程池的线程数(默认为CPU核数)，须在第一个LOOPER_SHARED日志器创建之前调用
+        void setBackendThreads(size_t threads)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            assert(!_backend); // 线程池已创建
+            _backend_threads = threads;
+        }
+        // 所有LOOPER_SHARED异步日志器共享的后台线程池(首次使用时创建)
+        BackendPool::ptr backend()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (!_backend)
+            {
+                size_t threads = _backend_threads;
+                if (threads == 0)
+                {
+                    threads = std::max(1u, std::thread::hardware_concurrency());
+                }
+                _backend = std::make_shared<BackendPool>(threads);
+            }
+            return _backend;
+        }
+
+    private:
+        LoggerManager();
+        ~LoggerManager() { stopStatsReport(); }
+        void stopStatsReport()
+        {
+            {
+                std::unique_lock<std::mutex> lock(_report_mutex);
+                _report_stop = true;
+            }
+            _report_cond.notify_all();
+            if (_report_thread.joinable())
+            {
+                _report_thread.join();
+            }
+        }
+        void statsReportEntry(size_t interval, std::string target)
+        {
+            std::unique_lock<std::mutex> lock(_report_mutex);
+            while (!_report_cond.wait_for(lock, std::chrono::seconds(interval), [this]()
+                                          { return _report_stop; }))
+            {
+                lock.unlock();
+                Logger::ptr logger = getLogger(target);
+                if (logger)
+                {
+                    for (auto &st : stats())
+                    {
+                        logger->Info(__FILE__, __LINE__, "%s", st.toString().c_str());
+                    }
+                }
+                lock.lock();
+            }
+        }
+
+    private:
+        std::mutex _report_mutex;
+        std::condition_variable _report_cond;
+        bool _report_stop = false;
+        std::thread _report_thread; // 周期性输出指标摘要
+        std::mutex _mutex;
+        size_t _backend_threads = 0;
+        BackendPool::ptr _backend; // 先于日志器构造、后于日志器析构
+        Logger::ptr _root_logger;  // 默认日志器
+        std::atomic<const LoggerMap *> _loggers;          // 当前快照
+        std::vector<std::unique_ptr<LoggerMap>> _snapshots; // 所有快照(注册时在_mutex内追加)
+    };
     /*使用建造者模式建造日志器，简化用户的操作*/
     enum LoggerType
     {
@@ -233,10 +961,27 @@ namespace log_master
     class LoggerBuilder
     {
     public:
-        LoggerBuilder() : _logger_type(LoggerType::LOGGER_SYNC), _limit_level(Log_level::DEBUG), _looper_type(AsyncLooper::AsyncType::ASYNC_SAFE) {}
+        LoggerBuilder() : _logger_type(LoggerType::LOGGER_SYNC), _limit_level(Log_level::DEBUG), _looper_type(AsyncLooper::AsyncType::ASYNC_SAFE), _looper_engine(LOOPER_DOUBLE_BUFFER), _deferred(false), _clock(Util::CLOCK_SRC_REALTIME), _sink_lanes(false), _lane_lag(0), _sync_combining(false) {}
 
         void buildLoggerType(LoggerType type) { _logger_type = type; }
         void buileEnableUnSafeAsync() { _looper_type = AsyncLooper::AsyncType::ASYNC_NOSAFE; }
+        // 选择异步工作器的实现(双缓冲区/无锁环形缓冲区/LoggerManager的共享后台线程池)
+        void buildLooperEngine(LooperEngine engine) { _looper_engine = engine; }
+        // 安全模式下缓冲区已满时的溢出策略(默认一直阻塞)，如OverflowPolicy::DropBelow(Log_level::WARNING)
+        void buildOverflowPolicy(const OverflowPolicy &policy) { _overflow_policy = policy; }
+        // 开启延迟格式化：xxx_bin接口只记录调用点id与原始参数，由后台线程格式化(仅异步日志器有效)
+        void buildEnableDeferredAsync() { _deferred = true; }
+        // 每个落地方向使用独立的写入线程，慢的落地方向只在自己的通道上积压(仅异步日志器有效)；
+        //  默认不丢弃日志，max_lag非0时积压超过max_lag字节的通道跳过新的批次(显式允许丢失，计入stats())
+        void buildEnableSinkLanes(size_t max_lag = 0)
+        {
+            _sink_lanes = true;
+            _lane_lag = max_lag;
+        }
+        // 同步日志器合并多个线程同时到达的日志，每个落地方向只写一次(仅同步日志器有效)
+        void buildEnableSyncCombining() { _sync_combining = true; }
+        // 选择日志时间戳的时钟源(默认CLOCK_SRC_REALTIME)
+        void buildLoggerClock(Util::ClockSource clock) { _clock = clock; }
         void buildLoggerName(const std::string &logger_name) { _logger_name = logger_name; }
         void buildLoggerFormatter(const std::string &pattern = "")
         {
@@ -247,16 +992,74 @@ namespace log_master
             }
             _formater = std::make_shared<Formatter>(pattern);
         }
+        // 结构化格式(FORMAT_JSON/FORMAT_LOGFMT)
+        void buildLoggerFormatter(FormatMode mode, const std::string &time_format = STRUCTURED_TIME_FORMAT)
+        {
+            _formater = std::make_shared<Formatter>(mode, time_format);
+        }
         void buildLoggerLevel(Log_level::level limit_level) { _limit_level = limit_level; }
         template <typename SinkType, typename... Args>
         void buildLoggerSinks(Args &&...args)
         {
             _logsinks.push_back(LogSinkFactory::Create<SinkType>(std::forward<Args>(args)...));
         }
+        // 设置最近添加的落地方向的最低输出等级，如文件记录DEBUG、标准输出只记录ERROR
+        void buildSinkLevel(Log_level::level level)
+        {
+            assert(!_logsinks.empty()); // 先添加落地方向
+            _logsinks.back()->setLevel(level);
+        }
+        // 设置最近添加的落地方向的持久化策略，如Durability::Interval(100)、Durability::Sync()
+        void buildSinkDurability(const Durability &durability)
+        {
+            assert(!_logsinks.empty()); // 先添加落地方向
+            _logsinks.back()->setDurability(durability);
+        }
+        // 为最近添加的滚动文件落地方向建立时间索引("<文件名>.idx"，约每block_size字节一项)，供log_master_query按时间与等级查询；
+        //  记录的时间与等级由后台线程(同步日志器为调用线程)随格式化一起取得
+        void buildSinkIndex(size_t block_size = INDEX_BLOCK_SIZE)
+        {
+            assert(!_logsinks.empty());               // 先添加落地方向
+            assert(_logsinks.back()->SupportsIndex()); // 仅RollByFileLogSink/RollByTimeLogSink
+            _logsinks.back()->setIndex(block_size);
+        }
+        // 设置最近添加的落地方向的格式(默认使用日志器的格式)，相同格式的落地方向共享一次格式化结果
+        void buildSinkFormatter(const std::string &pattern = "")
+        {
+            assert(!_logsinks.empty()); // 先添加落地方向
+            if (pattern.empty())
+            {
+                _logsinks.back()->setFormatter(std::make_shared<Formatter>());
+                return;
+            }
+            _logsinks.back()->setFormatter(std::make_shared<Formatter>(pattern));
+        }
+        void buildSinkFormatter(FormatMode mode, const std::string &time_format = STRUCTURED_TIME_FORMAT)
+        {
+            assert(!_logsinks.empty());
+            _logsinks.back()->setFormatter(std::make_shared<Formatter>(mode, time_format));
+        }
         virtual Logger::ptr build() = 0;
 
+    protected:
+        BackendPool::ptr backend()
+        {
+            if (_looper_engine != LOOPER_SHARED)
+            {
+                return BackendPool::ptr();
+            }
+            return LoggerManager::getInstance().backend();
+        }
+
     protected:
         AsyncLooper::AsyncType _looper_type;
+        LooperEngine _looper_engine;
+        OverflowPolicy _overflow_policy;
+        bool _deferred;
+        Util::ClockSource _clock;
+        bool _sink_lanes; // 是否开启写入通道
+        size_t _lane_lag; // 写入通道的积压上限(0为不跳过)
+        bool _sync_combining;
         Log_level::level _limit_level;
         Formatter::ptr _formater;
         std::string _logger_name;
@@ -278,82 +1081,66 @@ namespace log_master
             {
                 _logsinks.push_back(LogSinkFactory::Create<StdoutLogSink>());
             }
+            for (auto &e : _logsinks)
+            {
+                // 二进制落地方向只能用于延迟格式化的异步日志器
+                assert(!e->IsBinary() || (_deferred && _logger_type == LOGGER_ASYNC));
+            }
             if (_logger_type == LOGGER_ASYNC)
             {
-                return std::make_shared<AsyncLogger>(_limit_level, _formater, _logger_name, _logsinks, _looper_type);
+                return std::make_shared<AsyncLogger>(_limit_level, _formater, _logger_name, _logsinks, _looper_type, _looper_engine, _deferred, _clock, backend(), _overflow_policy, _sink_lanes, _lane_lag);
             }
-            return std::make_shared<SyncLogger>(_limit_level, _formater, _logger_name, _logsinks);
+            return std::make_shared<SyncLogger>(_limit_level, _formater, _logger_name, _logsinks, _clock, _sync_combining);
         }
     };
 
-    // 全局单例管理器
-    class LoggerManager
+    inline LoggerManager::LoggerManager()
     {
-    public:
-        static LoggerManager &getInstance()
-        {
-            static LoggerManager eton;
-            return eton;
-        }
-        bool hasLogger(const std::string &name)
-        {
-            std::unique_lock<std::mutex> lock(_mutex);
+        std::unique_ptr<log_master::LoggerBuilder> builder(new log_master::LocalLoggerBuilder());
+        builder->buildLoggerName("root");
+        _root_logger = builder->build();
+        std::unique_ptr<LoggerMap> loggers(new LoggerMap());
+        loggers->insert({"root", _root_logger});
+        _loggers.store(loggers.get(), std::memory_order_release);
+        _snapshots.push_back(std::move(loggers));
+    }
 
-            auto it = _loggers.find(name);
-            if (it == _loggers.end())
-            {
-                return false;
-            }
-            return true;
-        }
-
-        void addLogger(Logger::ptr &logger)
-        {
-            if (hasLogger(logger->name()))
-            {
-                return;
-            }
-            std::unique_lock<std::mutex> lock(_mutex);
-            
-            _loggers.insert({logger->name(), logger});
-        }
-        Logger::ptr getLogger(const std::string &name)
+    // 调用点缓存的日志器句柄(通过bitlog.h中的LOG_MASTER_LOGGER宏使用)：找到后缓存裸指针，之后不再查找；
+    //  日志器注册后由LoggerManager一直持有，指针在进程退出前有效
+    class LoggerHandle
+    {
+    public:
+        LoggerHandle(const char *name) : _name(name), _logger(nullptr) {}
+        // 日志器尚未注册时返回nullptr(下次调用重新查找)
+        Logger *get()
         {
-            std::unique_lock<std::mutex> lock(_mutex);
-
-            auto it = _loggers.find(name);
-            if (it == _loggers.end())
+            Logger *logger = _logger.load(std::memory_order_acquire);
+            if (logger != nullptr)
             {
-                return Logger::ptr();
+                return logger;
             }
-            return it->second;
-        }
-        Logger::ptr rootLogger()
-        {
-            return _root_logger;
-        }
-
-    private:
-        LoggerManager()
-        {
-            std::unique_ptr<log_master::LoggerBuilder> builder(new log_master::LocalLoggerBuilder());
-            builder->buildLoggerName("root");
-            _root_logger = builder->build();
-            _loggers.insert({"root", _root_logger});
+            logger = LoggerManager::getInstance().getLogger(_name).get();
+            _logger.store(logger, std::memory_order_release);
+            return logger;
         }
 
     private:
-        std::mutex _mutex;
-        Logger::ptr _root_logger; // 默认日志器
-        std::unordered_map<std::string, Logger::ptr> _loggers;
+        const char *_name;
+        std::atomic<Logger *> _logger;
     };
-    // 全局日志器的建造者
+
+    // 全局日志器的建造者：同名日志器已注册时返回已有的日志器(本次的配置不生效)
     class GlobalLoggerBuilder : public LoggerBuilder
     {
     public:
         Logger::ptr build() override
         {
             assert(!_logger_name.empty()); // 日志器名称不可为空
+            Logger::ptr existing = LoggerManager::getInstance().getLogger(_logger_name);
+            if (existing)
+            {
+                return existing;
+            }
             if (_formater.get() == nullptr)
             {
                 _formater = std::make_shared<Formatter>();
@@ -362,16 +1149,25 @@ namespace log_master
             {
                 _logsinks.push_back(LogSinkFactory::Create<StdoutLogSink>());
             }
+            for (auto &e : _logsinks)
+            {
+                // 二进制落地方向只能用于延迟格式化的异步日志器
+                assert(!e->IsBinary() || (_deferred && _logger_type == LOGGER_ASYNC));
+            }
             Logger::ptr logger;
             if (_logger_type == LOGGER_ASYNC)
             {
-                logger = std::make_shared<AsyncLogger>(_limit_level, _formater, _logger_name, _logsinks, _looper_type);
+                logger = std::make_shared<AsyncLogger>(_limit_level, _formater, _logger_name, _logsinks, _looper_type, _looper_engine, _deferred, _clock, backend(), _overflow_policy, _sink_lanes, _lane_lag);
             }
             else
             {
-                logger = std::make_shared<SyncLogger>(_limit_level, _formater, _logger_name, _logsinks);
+                logger = std::make_shared<SyncLogger>(_limit_level, _formater, _logger_name, _logsinks, _clock, _sync_combining);
+            }
+            // 并发构建同名日志器时只有一个注册成功，其余返回已注册的日志器
+            if (!LoggerManager::getInstance().addLogger(logger))
+            {
+                return LoggerManager::getInstance().getLogger(_logger_name);
             }
-            LoggerManager::getInstance().addLogger(logger);
             return logger;
         }
     };
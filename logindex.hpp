@@ -0,0 +1,241 @@
+#pragma once
+/*滚动文件的时间索引：每个日志文件旁写一个"<文件名>.idx"(通过LoggerBuilder::buildSinkIndex开启)
+    1.日志文件按记录边界切成约block_size字节的块，每块一条64字节的索引项：
+      块在日志文件中的偏移与长度、块内记录的最早/最晚时间、各等级的条数
+    2.文件关闭(滚动)时追加一条整个文件的汇总项(进程崩溃时没有汇总项，由读取方合并各块)
+    3.记录的时间与等级由后台线程的SinkRouter随文本一起交给落地方向(IndexMark)，生产者没有额外开销
+    tools/log_master_query读取索引，只读取与时间范围、等级相交的块*/
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "./log_level.hpp"
+
+namespace log_master
+{
+    #define INDEX_BLOCK_SIZE 64*1024 // 默认的索引块大小(字节)
+    #define INDEX_SUFFIX ".idx"
+    #define INDEX_LEVELS 6           // UNKNOW..FATAL
+
+    // 一条记录在本批文本中的起始位置、时间(纳秒，0表示未知)与等级
+    struct IndexMark
+    {
+        size_t _off;
+        uint64_t _ns;
+        Log_level::level _level;
+    };
+
+    namespace LogIndex
+    {
+        enum EntryKind
+        {
+            INDEX_BLOCK = 1, // 一个块
+            INDEX_FILE       // 整个文件的汇总
+        };
+        struct Entry
+        {
+            uint32_t _kind;
+            uint32_t _records;
+            uint64_t _offset; // 块在日志文件中的起始偏移
+            uint64_t _length;
+            uint64_t _min_ns; // 没有已知时间的记录时为UINT64_MAX
+            uint64_t _max_ns;
+            uint32_t _levels[INDEX_LEVELS];
+
+            void reset(uint32_t kind, uint64_t offset)
+            {
+                memset(this, 0, sizeof(*this));
+                _kind = kind;
+                _offset = offset;
+                _min_ns = UINT64_MAX;
+            }
+            void add(uint64_t ns, Log_level::level level, uint64_t len)
+            {
+                _records++;
+                _length += len;
+                if ((size_t)level < INDEX_LEVELS)
+                {
+                    _levels[level]++;
+                }
+                if (ns != 0)
+                {
+                    _min_ns = ns < _min_ns ? ns : _min_ns;
+                    _max_ns = ns > _max_ns ? ns : _max_ns;
+                }
+            }
+            void merge(const Entry &e)
+            {
+                _records += e._records;
+                _length += e._length;
+                for (size_t i = 0; i < INDEX_LEVELS; i++)
+                {
+                    _levels[i] += e._levels[i];
+                }
+                _min_ns = e._min_ns < _min_ns ? e._min_ns : _min_ns;
+                _max_ns = e._max_ns > _max_ns ? e._max_ns : _max_ns;
+            }
+            // 等级不低于level的记录数
+            uint64_t atLeast(Log_level::level level) const
+            {
+                uint64_t n = 0;
+                for (size_t i = (size_t)level; i < INDEX_LEVELS; i++)
+                {
+                    n += _levels[i];
+                }
+                return n;
+            }
+        };
+        static_assert(sizeof(Entry) == 64, "index entry layout");
+
+        // 日志文件对应的索引文件名(归档的"x.log.gz"与"x.log"共用"x.log.idx")
+        inline std::string IndexPath(const std::string &pathname)
+        {
+            const std::string gz = ".gz";
+            if (pathname.size() > gz.size() && pathname.compare(pathname.size() - gz.size(), gz.size(), gz) == 0)
+            {
+                return pathname.substr(0, pathname.size() - gz.size()) + INDEX_SUFFIX;
+            }
+            return pathname + INDEX_SUFFIX;
+        }
+
+        // 索引写入器(由落地方向在写入日志的线程中使用)；落地方向设置了持久化策略时随日志文件一起刷盘，
+        //  否则索引只写到内核(进程崩溃后索引缺少的部分由log_master_query当作没有索引的内容输出)
+        class Writer
+        {
+        public:
+            Writer() : _fd(-1), _block_size(INDEX_BLOCK_SIZE), _offset(0), _pos(0) {}
+            ~Writer() { close(false); }
+            bool isOpen() { return _fd >= 0; }
+            // offset:日志文件当前的长度(新的记录从这里开始)
+            bool open(const std::string &pathname, uint64_t offset, size_t block_size)
+            {
+                close(false);
+                _fd = ::open(IndexPath(pathname).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+                // 追加到已有索引之后(丢弃崩溃时写了一半的索引项)
+                off_t end = _fd >= 0 ? lseek(_fd, 0, SEEK_END) : 0;
+                _pos = end > 0 ? (uint64_t)end / sizeof(Entry) * sizeof(Entry) : 0;
+                _block_size = block_size;
+                _offset = offset;
+                _block.reset(INDEX_BLOCK, offset);
+                _file.reset(INDEX_FILE, offset);
+                return _fd >= 0;
+            }
+            // 追加一批写入日志文件的文本：marks为各条记录的起始位置，之外的字节(如没有标记的文本)计入当前块
+            void add(size_t len, const IndexMark *marks, size_t n)
+            {
+                size_t head = n == 0 ? len : marks[0]._off;
+                extend(head);
+                for (size_t i = 0; i < n; i++)
+                {
+                    size_t end = i + 1 < n ? marks[i + 1]._off : len;
+                    if (_block._length >= _block_size)
+                    {
+                        emit();
+                    }
+                    _block.add(marks[i]._ns, marks[i]._level, end - marks[i]._off);
+                    _offset += end - marks[i]._off;
+                }
+            }
+            // 写出未满的块与文件汇总后关闭(sync:关闭前刷盘)
+            void close(bool sync)
+            {
+                if (_fd < 0)
+                {
+                    return;
+                }
+                if (_block._length != 0)
+                {
+                    emit();
+                }
+                write(_file, true);
+                if (sync && _fd >= 0)
+                {
+                    ::fdatasync(_fd);
+                }
+                if (_fd >= 0)
+                {
+                    ::close(_fd);
+                    _fd = -1;
+                }
+            }
+            // 写出未满的块后刷盘，使已刷盘的日志都有对应的索引项；
+            //  未满的块写在下一个索引项的位置上，块写满(或再次刷盘)时原地覆盖，逐条刷盘时索引不会随刷盘次数增长
+            void sync()
+            {
+                if (_fd < 0)
+                {
+                    return;
+                }
+                if (_block._length != 0)
+                {
+                    write(_block, false);
+                }
+                if (_fd >= 0)
+                {
+                    ::fdatasync(_fd);
+                }
+            }
+
+        private:
+            void extend(size_t len)
+            {
+                _block._length += len;
+                _offset += len;
+            }
+            void emit()
+            {
+                write(_block, true);
+                _file.merge(_block);
+                _block.reset(INDEX_BLOCK, _offset);
+            }
+            // 在_pos处写入一个索引项，advance为false时下一次写入覆盖该项
+            void write(const Entry &e, bool advance)
+            {
+                if (::pwrite(_fd, &e, sizeof(e), (off_t)_pos) != (ssize_t)sizeof(e))
+                {
+                    // 索引只用于加速查询，写入失败时不影响日志本身
+                    ::close(_fd);
+                    _fd = -1;
+                    return;
+                }
+                _pos += advance ? sizeof(e) : 0;
+            }
+
+        private:
+            int _fd;
+            size_t _block_size;
+            uint64_t _offset; // 日志文件当前的长度
+            Entry _block;     // 正在累积的块
+            Entry _file;      // 已写出的块的汇总
+            uint64_t _pos;    // 下一个索引项在索引文件中的位置
+        };
+
+        // 读取一个索引文件：blocks为各块，file为各块的汇总(进程崩溃或文件被重新打开追加时汇总项缺失或不止一条，
+        // 因此总是由各块合并)，索引不存在时返回false
+        inline bool Read(const std::string &pathname, std::vector<Entry> &blocks, Entry &file)
+        {
+            blocks.clear();
+            file.reset(INDEX_FILE, 0);
+            int fd = ::open(IndexPath(pathname).c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return false;
+            }
+            Entry e;
+            while (::read(fd, &e, sizeof(e)) == (ssize_t)sizeof(e))
+            {
+                if (e._kind == INDEX_BLOCK)
+                {
+                    blocks.push_back(e);
+                    file.merge(e);
+                }
+            }
+            ::close(fd);
+            file._offset = blocks.empty() ? 0 : blocks.front()._offset;
+            return true;
+        }
+    }
+}
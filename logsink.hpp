@@ -9,17 +9,156 @@
 #include <fstream>
 #include <memory>
 #include <cassert>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "./util.hpp"
+#include "./format.hpp"
+#include "./binlog.hpp"
+#include "./ioengine.hpp"
+#include "./archive.hpp"
+#include "./stats.hpp"
+#include "./durability.hpp"
+#include "./logindex.hpp"
 namespace log_master
 {
+    #define DEFAULT_MMAP_CHUNK_SIZE 16*1024*1024
     class LogSink
     {
     public:
         using ptr = std::shared_ptr<LogSink>;
-        LogSink() {}
+        LogSink() : _level(Log_level::DEBUG), _index_block(0), _writes(0), _bytes(0), _syncs(0), _sync_ns(0), _last_sync(0), _unsynced(0) {}
         ~LogSink() {}
-        virtual void Log(const std::string &data, size_t len) = 0;
+        // 直接从调用方的内存(如异步缓冲区)中写出，不产生临时拷贝
+        virtual void Log(const char *data, size_t len) = 0;
+        // 建立时间索引时写入并更新索引：marks为本批各条记录的位置、时间与等级(见logindex.hpp)
+        virtual void LogIndexed(const char *data, size_t len, const IndexMark *, size_t) { Log(data, len); }
+        // 日志器通过Write调用Log，同时统计写入次数、字节数与耗时(调用方已串行化)
+        void Write(const char *data, size_t len, const IndexMark *marks = nullptr, size_t n = 0)
+        {
+            uint64_t begin = Stats::Now();
+            if (_index_block != 0)
+            {
+                LogIndexed(data, len, marks, n);
+            }
+            else
+            {
+                Log(data, len);
+            }
+            _latency.record(Stats::Now() - begin);
+            _writes.store(_writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            _bytes.store(_bytes.load(std::memory_order_relaxed) + len, std::memory_order_relaxed);
+            if (_durability._level == DURABILITY_NONE)
+            {
+                return;
+            }
+            std::unique_lock<std::mutex> lock(_commit_mutex);
+            _unsynced.store(_unsynced.load(std::memory_order_relaxed) + len, std::memory_order_relaxed);
+            if (_durability._level == DURABILITY_INTERVAL)
+            {
+                commitDue();
+                return;
+            }
+            commit(_durability._level == DURABILITY_SYNC);
+        }
+        // 等待异步写入完成后刷盘并统计(与Write由同一线程调用或已互斥，如Logger::flush()；与按间隔的刷盘由_commit_mutex互斥)
+        void Commit(bool data_only)
+        {
+            std::unique_lock<std::mutex> lock(_commit_mutex);
+            commit(data_only);
+        }
+        // 按间隔刷盘：有未刷盘的写入且距上次刷盘已超过间隔时刷盘(由定时器或写入通道在空闲时调用，与写入已互斥)；
+        //  返回仍有未刷盘的写入时距到期的纳秒数，否则返回0
+        uint64_t CommitDue()
+        {
+            std::unique_lock<std::mutex> lock(_commit_mutex);
+            return commitDue();
+        }
+        SinkStats stats()
+        {
+            SinkStats st;
+            st._writes = _writes.load(std::memory_order_relaxed);
+            st._bytes = _bytes.load(std::memory_order_relaxed);
+            st._latency = _latency.snapshot();
+            st._syncs = _syncs.load(std::memory_order_relaxed);
+            st._sync_ns = _sync_ns.load(std::memory_order_relaxed);
+            st._unsynced_bytes = _unsynced.load(std::memory_order_relaxed);
+            return st;
+        }
+        // 是否接收延迟格式化日志器的原始二进制帧(而不是格式化后的文本)
+        virtual bool IsBinary() { return false; }
+        // 是否异步写入：为true时传给Log的数据在Wait()返回前必须保持有效
+        virtual bool IsAsyncIo() { return false; }
+        // 等待已提交的异步写入完成
+        virtual void Wait() {}
+        // 将已写入的数据刷到存储设备(data_only时可以不刷无关的元数据)
+        virtual void Sync(bool) {}
+        // 是否支持时间索引(滚动文件)
+        virtual bool SupportsIndex() { return false; }
+        // 落地方向自身的最低输出等级与格式化器(为空时使用日志器的格式化器)，须在创建日志器之前设置
+        void setLevel(Log_level::level level) { _level = level; }
+        Log_level::level level() { return _level; }
+        void setFormatter(Formatter::ptr formatter) { _formatter = formatter; }
+        Formatter::ptr formatter() { return _formatter; }
+        void setDurability(const Durability &durability) { _durability = durability; }
+        const Durability &durability() { return _durability; }
+        // 为每个文件建立时间索引，约每block_size字节一个索引项
+        void setIndex(size_t block_size) { _index_block = block_size; }
+        bool indexed() { return _index_block != 0; }
+
+    private:
+        void commit(bool data_only)
+        {
+            uint64_t begin = Stats::Now();
+            Wait();
+            Sync(data_only);
+            _last_sync = Stats::Now();
+            _unsynced.store(0, std::memory_order_relaxed);
+            _syncs.store(_syncs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            _sync_ns.store(_sync_ns.load(std::memory_order_relaxed) + _last_sync - begin, std::memory_order_relaxed);
+        }
+        uint64_t commitDue()
+        {
+            if (_unsynced.load(std::memory_order_relaxed) == 0)
+            {
+                return 0;
+            }
+            uint64_t interval = (uint64_t)_durability._interval_ms * 1000000;
+            uint64_t elapsed = Stats::Now() - _last_sync;
+            if (elapsed < interval)
+            {
+                return interval - elapsed;
+            }
+            commit(false);
+            return 0;
+        }
+
+    protected:
+        Log_level::level _level;
+        Formatter::ptr _formatter;
+        Durability _durability;
+        size_t _index_block; // 时间索引的块大小(0为不建立索引)
+        std::atomic<uint64_t> _writes;
+        std::atomic<uint64_t> _bytes;
+        Stats::LatencyHistogram _latency;
+        std::atomic<uint64_t> _syncs;
+        std::atomic<uint64_t> _sync_ns;
+        uint64_t _last_sync;             // 上次刷盘的时间(单调时钟，受_commit_mutex保护)
+        std::atomic<uint64_t> _unsynced; // 上次刷盘以来写入的字节数(仅设置了持久化策略时统计，受_commit_mutex保护)
+        std::mutex _commit_mutex;
     };
 
     // 标准输出:StdoutSink
@@ -27,77 +166,292 @@ namespace log_master
     {
     public:
         // 将日志写入到标准输出
-        void Log(const std::string &data, size_t len) override
+        void Log(const char *data, size_t len) override
         {
-            std::cout.write(data.c_str(), len);
+            std::cout.write(data, len);
         }
+        void Sync(bool) override { std::cout.flush(); }
     };
 
     // 固定文件:FileSink
     class FileLogSink : public LogSink
     {
     public:
-        // 构造时传入文件名，并打开文件，把文件句柄管理起来
-        FileLogSink(const std::string &filepath) : _filepath(filepath)
+        // 构造时传入文件名，并打开文件，把文件句柄管理起来(engine为空时使用ofstream写入)
+        FileLogSink(const std::string &filepath, IoEngine::ptr engine = IoEngine::ptr()) : _filepath(filepath), _file(engine)
         {
             std::string path = log_master::Util::File::Path(_filepath);
             log_master::Util::File::CreateDirectory(path);
-            _ofs.open(_filepath, std::ios::binary | std::ios::app);
-            assert(_ofs.is_open());
+            bool ret = _file.open(_filepath);
+            assert(ret);
+            (void)ret;
         }
-        void Log(const std::string &data, size_t len) override
+        void Log(const char *data, size_t len) override
         {
-            _ofs.write(data.c_str(), len);
-            assert(_ofs.good());
+            _file.write(data, len);
+            assert(_file.good());
         }
+        bool IsAsyncIo() override { return _file.async(); }
+        void Wait() override { _file.wait(); }
+        void Sync(bool data_only) override { _file.sync(data_only); }
 
     private:
         std::string _filepath;
-        std::ofstream _ofs;
+        LogFile _file;
+    };
+
+    // 滚动文件的辅助线程：
+    //  1.提前打开下一个文件(生成文件名、创建目录、打开)，滚动时只需交换文件对象
+    //  2.在后台关闭滚动下来的文件，然后交给归档
+    //  3.按时间滚动时兼作定时器：到达时间段边界时更新period()，写入路径上不再每次读取时间
+    class RollHelper
+    {
+    public:
+        using Namer = std::function<std::string(uint64_t)>; // 由序号(或时间段)生成文件名，须可在多个线程中调用
+        RollHelper(const Namer &namer, IoEngine::ptr engine, Archiver::ptr archiver, time_t gap_size = 0)
+            : _namer(namer), _engine(engine), _archiver(archiver), _gap_size(gap_size), _next_key(0), _want(false), _preparing(false), _stop(false)
+        {
+            _period = _gap_size ? Util::Date::getTime() / _gap_size : 0;
+            _thread = std::thread(&RollHelper::threadEntry, this);
+        }
+        ~RollHelper()
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _cond.notify_all();
+            _thread.join();
+            for (auto &e : _retired)
+            {
+                retireOne(e);
+            }
+            discardNext();
+        }
+        // 当前时间段(按时间滚动时由定时器更新，边界附近的日志可能仍写入前一个文件)
+        uint64_t period() { return _period.load(std::memory_order_relaxed); }
+        // 取得序号为key的文件：已预先打开时直接交换，否则在调用线程中打开；之后在后台准备key+1
+        std::unique_ptr<LogFile> take(uint64_t key, std::string &pathname)
+        {
+            std::unique_ptr<LogFile> file;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cond.wait(lock, [&]()
+                           { return !_preparing; });
+                if (_next && _next_key == key)
+                {
+                    file = std::move(_next);
+                    pathname = _next_name;
+                }
+                else
+                {
+                    // 时间跳变等原因预先打开的文件已不是所需的文件
+                    discardNext();
+                }
+                _next_key = key + 1;
+                _want = true;
+            }
+            _cond.notify_all();
+            if (!file)
+            {
+                pathname = _namer(key);
+                file = OpenFile(pathname, _engine);
+            }
+            return file;
+        }
+        // 交出滚动下来的文件(先等待其在途写入完成)，由辅助线程关闭并归档
+        void retire(std::unique_ptr<LogFile> file, const std::string &pathname)
+        {
+            file->wait();
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _retired.push_back(Retired{std::move(file), pathname});
+            }
+            _cond.notify_all();
+        }
+
+    private:
+        struct Retired
+        {
+            std::unique_ptr<LogFile> _file;
+            std::string _pathname;
+        };
+        static std::unique_ptr<LogFile> OpenFile(const std::string &pathname, IoEngine::ptr engine)
+        {
+            log_master::Util::File::CreateDirectory(log_master::Util::File::Path(pathname));
+            std::unique_ptr<LogFile> file(new LogFile(engine));
+            if (!file->open(pathname))
+            {
+                return std::unique_ptr<LogFile>();
+            }
+            return file;
+        }
+        void retireOne(Retired &e)
+        {
+            e._file->close(false);
+            if (_archiver)
+            {
+                _archiver->submit(e._pathname);
+            }
+        }
+        // 关闭预先打开但未使用的文件(仍为空时删除)
+        void discardNext()
+        {
+            if (!_next)
+            {
+                return;
+            }
+            _next->close();
+            _next.reset();
+            struct stat st;
+            if (stat(_next_name.c_str(), &st) == 0 && st.st_size == 0)
+            {
+                unlink(_next_name.c_str());
+            }
+        }
+        void threadEntry()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                if (_gap_size != 0)
+                {
+                    uint64_t period = Util::Date::getTime() / _gap_size;
+                    if (period != _period.load(std::memory_order_relaxed))
+                    {
+                        _period.store(period, std::memory_order_relaxed);
+                    }
+                }
+                if (!_retired.empty())
+                {
+                    Retired e = std::move(_retired.front());
+                    _retired.pop_front();
+                    lock.unlock();
+                    retireOne(e);
+                    lock.lock();
+                    continue;
+                }
+                if (_stop)
+                {
+                    return;
+                }
+                if (_want)
+                {
+                    _want = false;
+                    _preparing = true;
+                    uint64_t key = _next_key;
+                    lock.unlock();
+                    std::string pathname = _namer(key);
+                    std::unique_ptr<LogFile> file = OpenFile(pathname, _engine);
+                    lock.lock();
+                    _preparing = false;
+                    _next = std::move(file);
+                    _next_name = pathname;
+                    _cond.notify_all();
+                    continue;
+                }
+                if (_gap_size == 0)
+                {
+                    _cond.wait(lock);
+                    continue;
+                }
+                // 等到下一个时间段的起点
+                time_t boundary = (time_t)(_period.load(std::memory_order_relaxed) + 1) * _gap_size;
+                _cond.wait_until(lock, std::chrono::system_clock::from_time_t(boundary));
+            }
+        }
+
+    private:
+        Namer _namer;
+        IoEngine::ptr _engine;
+        Archiver::ptr _archiver;
+        time_t _gap_size;               // 时间段大小(0表示不按时间滚动)
+        std::atomic<uint64_t> _period;  // 当前时间段
+        std::unique_ptr<LogFile> _next; // 预先打开的文件
+        std::string _next_name;
+        uint64_t _next_key;             // 预先打开的文件的序号
+        bool _want;                     // 是否需要准备_next_key对应的文件
+        bool _preparing;                // 辅助线程正在打开文件
+        bool _stop;
+        std::deque<Retired> _retired;   // 待关闭的文件
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::thread _thread;
     };
 
     // 滚动文件:RollSink(以大小滚动)
+    //  下一个文件由RollHelper提前打开(文件名中的时间为打开时间)，滚动只是一次文件对象的交换
     class RollByFileLogSink : public LogSink
     {
 
     public:
-        // 构造时传入文件名，并打开文件，把文件句柄管理起来
-        RollByFileLogSink(const std::string &basename, size_t max_fsize) : _basename(basename), _max_fsize(max_fsize)
+        // 构造时传入文件名，并打开文件，把文件句柄管理起来(archive:关闭的文件的压缩与保留策略)
+        RollByFileLogSink(const std::string &basename, size_t max_fsize, IoEngine::ptr engine = IoEngine::ptr(), const ArchivePolicy &archive = ArchivePolicy())
+            : _basename(basename), _max_fsize(max_fsize), _cur_fsize(0)
         {
             // 创新文件所在目录
             log_master::Util::File::CreateDirectory(log_master::Util::File::Path(_basename));
-            std::string pathname = CreateNFileName();
+            Archiver::ptr archiver;
+            if (archive.enabled())
+            {
+                archiver = std::make_shared<Archiver>(_basename, archive);
+            }
+            std::string name = _basename;
+            _helper.reset(new RollHelper([name](uint64_t count)
+                                         { return RollFileName(name, count); }, engine, archiver));
             // 打开文件
-            _ofs.open(pathname, std::ios::app | std::ios::binary);
-            assert(_ofs.is_open());
+            _file = _helper->take(_name_count++, _pathname);
+            assert(_file);
+            _file_base = Util::File::Size(_pathname);
         }
         // 写入前判断文件大小，超过最大值后切换文件
-        void Log(const std::string &data, size_t len) override
+        void Log(const char *data, size_t len) override
         {
             if (_cur_fsize >= _max_fsize)
             {
-                _ofs.close(); // 关闭原来打开的文件
-
-                std::string pathname = CreateNFileName();
-
-                _ofs.open(pathname, std::ios::app | std::ios::binary);
-                assert(_ofs.is_open());
+                // 旧文件交给辅助线程关闭，换上预先打开的文件(开启持久化时先刷盘)
+                if (_durability._level != DURABILITY_NONE)
+                {
+                    _file->sync(false);
+                }
+                _index.close(_durability._level != DURABILITY_NONE);
+                _helper->retire(std::move(_file), _pathname);
+                _file = _helper->take(_name_count++, _pathname);
+                assert(_file);
+                _file_base = Util::File::Size(_pathname);
                 _cur_fsize = 0;
             }
-            _ofs.write(data.c_str(), len);
+            _file->write(data, len);
             _cur_fsize += len;
-            assert(_ofs.good());
+            assert(_file->good());
         }
-
-    private:
-        std::string CreateNFileName()
+        // 索引在文件的第一次写入时打开(写入前文件可能已滚动)
+        void LogIndexed(const char *data, size_t len, const IndexMark *marks, size_t n) override
+        {
+            Log(data, len);
+            if (!_index.isOpen())
+            {
+                _index.open(_pathname, _file_base + _cur_fsize - len, _index_block);
+            }
+            _index.add(len, marks, n);
+        }
+        bool SupportsIndex() override { return true; }
+        bool IsAsyncIo() override { return _file->async(); }
+        void Wait() override { _file->wait(); }
+        void Sync(bool data_only) override
+        {
+            _file->sync(data_only);
+            _index.sync();
+        }
+        // 按大小滚动的文件名：basename+时间+"-"+序号+".log"
+        static std::string RollFileName(const std::string &basename, size_t count)
         {
             time_t tm = log_master::Util::Date::getTime();
             struct tm t;
             localtime_r(&tm, &t);
             std::stringstream filename;
 
-            filename << _basename;
+            filename << basename;
             filename << t.tm_year + 1900;
             filename << t.tm_mon + 1;
             filename << t.tm_mday;
@@ -105,7 +459,7 @@ namespace log_master
             filename << t.tm_min;
             filename << t.tm_sec;
             filename << "-";
-            filename << _name_count++;
+            filename << count;
             filename << ".log";
             return filename.str();
         }
@@ -115,10 +469,142 @@ namespace log_master
         std::string _basename; //_filename+拓展文件名(时间)=实际文件名
         size_t _max_fsize;     // 记录文件最大大小，超过后开新文件
         size_t _cur_fsize;     // 记录文件当前大小
-        std::ofstream _ofs;
+        size_t _file_base = 0; // 打开时文件已有的大小(索引中的偏移从这里开始)
+        std::string _pathname; // 当前文件名
+        std::unique_ptr<RollHelper> _helper;
+        std::unique_ptr<LogFile> _file;
+        LogIndex::Writer _index;
+    };
+
+    // 内存映射文件:MmapFileSink(以大小滚动)
+    //  按块预分配(fallocate)文件空间并映射到内存，写入即memcpy到映射区，不需要每批一次系统调用；
+    //  已拷贝进映射区的日志在进程崩溃后仍由内核写回。关闭/滚动时截断到实际长度
+    //  (进程崩溃时文件末尾会残留未使用的预分配空间，内容为0)
+    class MmapFileLogSink : public LogSink
+    {
+    public:
+        MmapFileLogSink(const std::string &basename, size_t max_fsize, size_t chunk_size = DEFAULT_MMAP_CHUNK_SIZE, const ArchivePolicy &archive = ArchivePolicy())
+            : _basename(basename), _max_fsize(max_fsize), _chunk_size(chunk_size), _fd(-1), _map(MAP_FAILED), _mapped(0), _cur_fsize(0)
+        {
+            assert(_chunk_size > 0);
+            log_master::Util::File::CreateDirectory(log_master::Util::File::Path(_basename));
+            if (archive.enabled())
+            {
+                _archiver = std::make_shared<Archiver>(_basename, archive);
+            }
+            bool ret = openFile();
+            assert(ret);
+            (void)ret;
+        }
+        ~MmapFileLogSink() { closeFile(); }
+        void Log(const char *data, size_t len) override
+        {
+            if (_cur_fsize >= _max_fsize)
+            {
+                closeFile();
+                if (_archiver)
+                {
+                    _archiver->submit(_pathname);
+                }
+                bool ret = openFile();
+                assert(ret);
+                (void)ret;
+            }
+            if (_cur_fsize + len > _mapped && !grow(_cur_fsize + len))
+            {
+                return;
+            }
+            memcpy((char *)_map + _cur_fsize, data, len);
+            _cur_fsize += len;
+        }
+        // 映射区的写回由msync完成，元数据(文件大小)另需fsync
+        void Sync(bool data_only) override
+        {
+            if (_map == MAP_FAILED)
+            {
+                return;
+            }
+            msync(_map, _cur_fsize, MS_SYNC);
+            if (!data_only)
+            {
+                ::fsync(_fd);
+            }
+        }
+
+    private:
+        bool openFile()
+        {
+            _pathname = RollByFileLogSink::RollFileName(_basename, _name_count++);
+            _fd = ::open(_pathname.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (_fd < 0)
+            {
+                return false;
+            }
+            struct stat st;
+            _cur_fsize = fstat(_fd, &st) == 0 ? st.st_size : 0;
+            return grow(_cur_fsize + 1);
+        }
+        // 预分配并映射至少need字节(按块对齐)
+        bool grow(size_t need)
+        {
+            size_t size = (need + _chunk_size - 1) / _chunk_size * _chunk_size;
+            // 只有文件系统不支持fallocate时才用ftruncate扩展(稀疏文件)；空间不足等错误时不映射，
+            // 否则写入没有磁盘块的映射页会触发SIGBUS
+            if (fallocate(_fd, 0, _mapped, size - _mapped) != 0 && (errno != EOPNOTSUPP || ftruncate(_fd, size) != 0))
+            {
+                std::cout << "预分配日志文件空间失败:" << strerror(errno) << std::endl;
+                return false;
+            }
+            void *map = _map == MAP_FAILED ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0)
+                                           : mremap(_map, _mapped, size, MREMAP_MAYMOVE);
+            if (map == MAP_FAILED)
+            {
+                std::cout << "映射日志文件失败" << std::endl;
+                return false;
+            }
+            _map = map;
+            _mapped = size;
+            return true;
+        }
+        void closeFile()
+        {
+            if (_map != MAP_FAILED)
+            {
+                munmap(_map, _mapped);
+                _map = MAP_FAILED;
+                _mapped = 0;
+            }
+            if (_fd >= 0)
+            {
+                // 截掉未使用的预分配空间
+                if (ftruncate(_fd, _cur_fsize) != 0)
+                {
+                    std::cout << "截断日志文件失败" << std::endl;
+                }
+                if (_durability._level != DURABILITY_NONE)
+                {
+                    ::fsync(_fd);
+                }
+                ::close(_fd);
+                _fd = -1;
+            }
+        }
+
+    private:
+        size_t _name_count = 0;
+        std::string _basename;
+        size_t _max_fsize;  // 记录文件最大大小，超过后开新文件
+        size_t _chunk_size; // 每次预分配的大小
+        int _fd;
+        void *_map;         // 映射区起始地址
+        size_t _mapped;     // 已预分配并映射的大小
+        size_t _cur_fsize;  // 已写入的实际大小
+        std::string _pathname;
+        Archiver::ptr _archiver;
     };
 
     // 滚动文件:RollSink(以时间段滚动)
+    //  由RollHelper的定时器在时间段边界更新当前时间段，并提前打开下一个时间段的文件(文件名为时间段的起始时间)
     class RollByTimeLogSink : public LogSink
     {
     public:
@@ -130,12 +616,14 @@ namespace log_master
             GAP_DAY
         };
         // 构造时传入文件名，并打开文件，把文件句柄管理起来
-        RollByTimeLogSink(const std::string &basename,Gap_Size gap_type) : _basename(basename)
+        RollByTimeLogSink(const std::string &basename, Gap_Size gap_type, IoEngine::ptr engine = IoEngine::ptr(), const ArchivePolicy &archive = ArchivePolicy())
+            : _basename(basename)
         {
             switch (gap_type)
             {
             case Gap_Size::GAP_SECOND:
                 _gap_size = 1;
+                break;
             case Gap_Size::GAP_MINUTE:
                 _gap_size = 60;
                 break;
@@ -146,40 +634,71 @@ namespace log_master
                 _gap_size = 24 * 3600;
                 break;
             }
-            // 初始化当前时间段
-            time_t cur_time = log_master::Util::Date::getTime();
-            _cur_gap = cur_time / _gap_size;
             // 创新文件所在目录
             log_master::Util::File::CreateDirectory(log_master::Util::File::Path(_basename));
-            std::string pathname = CreateNFileName();
-            // 打开文件
-            _ofs.open(pathname, std::ios::app | std::ios::binary);
-            assert(_ofs.is_open());
+            Archiver::ptr archiver;
+            if (archive.enabled())
+            {
+                archiver = std::make_shared<Archiver>(_basename, archive);
+            }
+            std::string name = _basename;
+            size_t gap = _gap_size;
+            _helper.reset(new RollHelper([name, gap](uint64_t period)
+                                         { return TimeFileName(name, (time_t)(period * gap)); }, engine, archiver, _gap_size));
+            // 初始化当前时间段并打开文件
+            _cur_gap = _helper->period();
+            _file = _helper->take(_cur_gap, _pathname);
+            assert(_file);
+            _cur_fsize = Util::File::Size(_pathname);
         }
-        // 写入前判断文件大小，超过最大值后切换文件
-        void Log(const std::string &data, size_t len) override
+        // 定时器更新了时间段后切换文件
+        void Log(const char *data, size_t len) override
         {
-            time_t cur_time = log_master::Util::Date::getTime();
-            if (_cur_gap != cur_time / _gap_size)
+            uint64_t period = _helper->period();
+            if (_cur_gap != period)
             {
-                _ofs.close(); // 关闭原来打开的文件
-                std::string pathname = CreateNFileName();
-                _ofs.open(pathname, std::ios::app | std::ios::binary);
-                assert(_ofs.is_open());
+                // 旧文件交给辅助线程关闭，换上预先打开的文件(开启持久化时先刷盘)
+                if (_durability._level != DURABILITY_NONE)
+                {
+                    _file->sync(false);
+                }
+                _index.close(_durability._level != DURABILITY_NONE);
+                _helper->retire(std::move(_file), _pathname);
+                _file = _helper->take(period, _pathname);
+                assert(_file);
+                _cur_gap = period;
+                _cur_fsize = Util::File::Size(_pathname);
             }
-            _ofs.write(data.c_str(), len);
-            assert(_ofs.good());
+            _file->write(data, len);
+            _cur_fsize += len;
+            assert(_file->good());
         }
-
-    private:
-        std::string CreateNFileName()
+        // 索引在文件的第一次写入时打开(写入前文件可能已滚动)
+        void LogIndexed(const char *data, size_t len, const IndexMark *marks, size_t n) override
+        {
+            Log(data, len);
+            if (!_index.isOpen())
+            {
+                _index.open(_pathname, _cur_fsize - len, _index_block);
+            }
+            _index.add(len, marks, n);
+        }
+        bool SupportsIndex() override { return true; }
+        bool IsAsyncIo() override { return _file->async(); }
+        void Wait() override { _file->wait(); }
+        void Sync(bool data_only) override
+        {
+            _file->sync(data_only);
+            _index.sync();
+        }
+        // 按时间滚动的文件名：basename+时间段起始时间+".log"
+        static std::string TimeFileName(const std::string &basename, time_t tm)
         {
-            time_t tm = log_master::Util::Date::getTime();
             struct tm t;
             localtime_r(&tm, &t);
             std::stringstream filename;
 
-            filename << _basename;
+            filename << basename;
             filename << t.tm_year + 1900;
             filename << t.tm_mon + 1;
             filename << t.tm_mday;
@@ -193,8 +712,90 @@ namespace log_master
     private:
         std::string _basename; //_filename+拓展文件名(时间)=实际文件名
         size_t _gap_size;      // 时间段大小
-        size_t _cur_gap;       // 第几个时间段
+        uint64_t _cur_gap;     // 第几个时间段
+        size_t _cur_fsize;     // 当前文件大小(索引中的偏移)
+        std::string _pathname; // 当前文件名
+        std::unique_ptr<RollHelper> _helper;
+        std::unique_ptr<LogFile> _file;
+        LogIndex::Writer _index;
+    };
+
+    // 二进制文件:BinaryFileSink(仅用于延迟格式化的异步日志器，由log_master_decode离线还原)
+    class BinaryFileLogSink : public LogSink
+    {
+    public:
+        BinaryFileLogSink(const std::string &filepath) : _filepath(filepath)
+        {
+            std::string path = log_master::Util::File::Path(_filepath);
+            log_master::Util::File::CreateDirectory(path);
+            bool exist = log_master::Util::File::IsExist(_filepath);
+            _ofs.open(_filepath, std::ios::binary | std::ios::app);
+            assert(_ofs.is_open());
+            if (!exist)
+            {
+                _ofs.write(BINLOG_FILE_MAGIC, strlen(BINLOG_FILE_MAGIC));
+            }
+        }
+        bool IsBinary() override { return true; }
+        // 先写出本批次中首次出现的调用点信息，再原样写出日志帧
+        void Log(const char *data, size_t len) override
+        {
+            FmtStr::Writer sites;
+            size_t pos = 0;
+            while (len - pos >= BinLog::FRAME_HEADER_SIZE)
+            {
+                uint32_t head[2];
+                memcpy(head, data + pos, sizeof(head));
+                if (head[0] < BinLog::FRAME_HEADER_SIZE || head[0] > len - pos)
+                {
+                    break;
+                }
+                if (head[1] == BinLog::FRAME_RECORD)
+                {
+                    uint32_t id;
+                    memcpy(&id, data + pos + BinLog::FRAME_HEADER_SIZE, sizeof(id));
+                    if (id >= _written.size())
+                    {
+                        _written.resize(id + 1, false);
+                    }
+                    const BinLog::CallSite *site = BinLog::Registry::getInstance().find(id);
+                    if (!_written[id] && site != nullptr)
+                    {
+                        BinLog::EncodeSite(sites, *site);
+                        _written[id] = true;
+                    }
+                }
+                pos += head[0];
+            }
+            _ofs.write(sites.data(), sites.size());
+            _ofs.write(data, len);
+            assert(_ofs.good());
+        }
+        void Sync(bool data_only) override
+        {
+            _ofs.flush();
+            if (_sync_fd < 0)
+            {
+                _sync_fd = ::open(_filepath.c_str(), O_RDONLY | O_CLOEXEC);
+            }
+            if (_sync_fd >= 0)
+            {
+                IoEngine::Sync(_sync_fd, data_only);
+            }
+        }
+        ~BinaryFileLogSink()
+        {
+            if (_sync_fd >= 0)
+            {
+                ::close(_sync_fd);
+            }
+        }
+
+    private:
+        std::string _filepath;
+        std::vector<bool> _written; // 已写入文件的调用点
         std::ofstream _ofs;
+        int _sync_fd = -1; // 刷盘用的只读描述符(首次刷盘时打开)
     };
 
     class LogSinkFactory
@@ -206,4 +807,160 @@ namespace log_master
             return std::make_shared<Sinktype>(std::forward<Args>(args)...);
         }
     };
+
+    /*按落地方向分发日志：文本落地方向按(格式化器, 最低等级)分组
+        1.每条日志对每种不同的格式只格式化一次，等级相同、格式相同的落地方向共享同一份文本
+        2.等级不够的分组不追加，所有分组都不接收时不做任何格式化
+        3.分组中有建立时间索引的落地方向时，同时记录每条日志在文本中的位置、时间与等级(IndexMark)
+      二进制落地方向不参与分组(直接写原始帧)*/
+    class SinkRouter
+    {
+    public:
+        SinkRouter() {}
+        SinkRouter(Formatter::ptr formatter, const std::vector<LogSink::ptr> &logsinks, Log_level::level limit_level)
+        {
+            _min_level = Log_level::OFF;
+            for (auto &e : logsinks)
+            {
+                _min_level = std::min(_min_level, e->level());
+            }
+            if (logsinks.empty())
+            {
+                _min_level = Log_level::DEBUG;
+            }
+            _min_level = std::max(_min_level, limit_level);
+            for (auto &e : logsinks)
+            {
+                if (e->IsBinary())
+                {
+                    continue;
+                }
+                Formatter::ptr f = e->formatter() ? e->formatter() : formatter;
+                size_t fmt = 0;
+                while (fmt < _formats.size() && _formats[fmt]._formatter->pattern() != f->pattern())
+                {
+                    fmt++;
+                }
+                if (fmt == _formats.size())
+                {
+                    _formats.push_back(Format(f));
+                }
+                // 不高于日志器有效等级的落地方向接收全部日志，归为同一组
+                Log_level::level level = std::max(e->level(), _min_level);
+                size_t i = 0;
+                while (i < _outs.size() && (_outs[i]._fmt != fmt || _outs[i]._level != level))
+                {
+                    i++;
+                }
+                if (i == _outs.size())
+                {
+                    _outs.push_back(Out{fmt, level, std::string(), std::vector<LogSink::ptr>(), std::vector<IndexMark>(), false});
+                }
+                _outs[i]._sinks.push_back(e);
+                _outs[i]._indexed = _outs[i]._indexed || e->indexed();
+                _indexed = _indexed || e->indexed();
+            }
+        }
+        // 日志器的有效等级(低于所有落地方向等级的日志无需格式化)
+        Log_level::level minLevel() { return _min_level; }
+        // 是否需要按落地方向分发(只有一个分组时所有文本落地方向收到相同的字节；建立时间索引时需要每条日志的时间与等级)
+        bool routed() { return _outs.size() > 1 || _indexed; }
+        // 只有一个分组时该组使用的格式化器
+        Formatter::ptr formatter() { return _formats.empty() ? Formatter::ptr() : _formats[0]._formatter; }
+        void clear()
+        {
+            for (auto &o : _outs)
+            {
+                o._text.clear();
+                o._marks.clear();
+            }
+        }
+        // 格式化并追加到接收该等级的各分组
+        void route(const Message::LogMsg &msg)
+        {
+            _record++;
+            for (size_t i = 0; i < _outs.size(); i++)
+            {
+                Out &o = _outs[i];
+                if (msg._level < o._level)
+                {
+                    continue;
+                }
+                if (o._indexed)
+                {
+                    o._marks.push_back(IndexMark{o._text.size(), (uint64_t)msg._ctime * 1000000000ull + msg._nsec, msg._level});
+                }
+                Format &f = _formats[o._fmt];
+                if (f._record != _record)
+                {
+                    // 本条日志第一次使用该格式：格式化到当前分组，记录位置供其他分组复制
+                    f._record = _record;
+                    f._owner = i;
+                    f._begin = o._text.size();
+                    f._formatter->Format(o._text, msg);
+                    continue;
+                }
+                Out &src = _outs[f._owner];
+                o._text.append(src._text, f._begin, std::string::npos);
+            }
+        }
+        // 已格式化好的文本(等级未知)追加到所有分组
+        void routeText(const char *data, size_t len)
+        {
+            for (auto &o : _outs)
+            {
+                if (o._indexed)
+                {
+                    o._marks.push_back(IndexMark{o._text.size(), 0, Log_level::UNKNOW});
+                }
+                o._text.append(data, len);
+            }
+        }
+        // 将各分组的文本写入对应的落地方向(异步写入时文本保留到下一次clear)
+        void flush()
+        {
+            flush([](const std::string &text, const std::vector<IndexMark> &marks, const std::vector<LogSink::ptr> &sinks)
+                  {
+                      for (auto &e : sinks)
+                      {
+                          e->Write(text.data(), text.size(), marks.data(), marks.size());
+                      } });
+        }
+        // 将各分组的文本交给write(文本, 索引标记, 该组的落地方向)，如异步日志器的写入通道
+        template <typename F>
+        void flush(F write)
+        {
+            for (auto &o : _outs)
+            {
+                if (!o._text.empty())
+                {
+                    write(o._text, o._marks, o._sinks);
+                }
+            }
+        }
+
+    private:
+        struct Format
+        {
+            Format(Formatter::ptr formatter) : _formatter(formatter), _record(0), _owner(0), _begin(0) {}
+            Formatter::ptr _formatter;
+            uint64_t _record; // 最近一次格式化的日志序号
+            size_t _owner;    // 该条日志格式化到的分组
+            size_t _begin;    // 在该分组文本中的起始位置
+        };
+        struct Out
+        {
+            size_t _fmt;
+            Log_level::level _level;
+            std::string _text;
+            std::vector<LogSink::ptr> _sinks;
+            std::vector<IndexMark> _marks; // 各条日志在_text中的位置(仅_indexed时记录)
+            bool _indexed;                 // 组内有建立时间索引的落地方向
+        };
+        Log_level::level _min_level = Log_level::DEBUG;
+        bool _indexed = false;
+        uint64_t _record = 0;
+        std::vector<Format> _formats;
+        std::vector<Out> _outs;
+    };
 }
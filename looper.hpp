@@ -6,12 +6,27 @@
 #include <condition_variable>
 #include <memory>
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
 
 #include "./buffer.hpp"
+#include "./ringbuffer.hpp"
+#include "./overflow.hpp"
+#include "./stats.hpp"
 
 namespace log_master
 {
+    #define POOLED_BUFFER_SIZE 64*1024 // 共享后台线程池模式下每个工作器缓冲区的初始大小
     using Functor = std::function<void(Buffer &)>;
+    // 异步工作器的实现方式
+    enum LooperEngine
+    {
+        LOOPER_DOUBLE_BUFFER, // 双缓冲区+互斥锁(默认)
+        LOOPER_RING,          // 无锁MPSC环形缓冲区
+        LOOPER_SHARED         // 不创建独立线程，由共享后台线程池(BackendPool)服务
+    };
+    // 异步工作器抽象基类
     class AsyncLooper
     {
     public:
@@ -23,52 +38,252 @@ namespace log_master
         using ptr = std::shared_ptr<AsyncLooper>;
 
     public:
-        AsyncLooper(const Functor &callback, AsyncLooper::AsyncType type = ASYNC_SAFE) : _stop(false), _thread(std::thread(&AsyncLooper::threadEntry, this)), _callback(callback), _looper_type(type) {}
-        ~AsyncLooper() { stop(); }
-        void push(const std::string &data, size_t len)
+        AsyncLooper(const OverflowPolicy &policy = OverflowPolicy())
+            : _policy(policy), _dropped(0), _spilled(0), _batches(0), _batch_bytes(0), _max_batch(0), _blocked(0), _blocked_ns(0)
+        {
+            if (_policy._type == OVERFLOW_SPILL)
+            {
+                _spill.reset(new SpillFile(_policy._spill_path));
+            }
+        }
+        virtual ~AsyncLooper() {}
+        // level用于OVERFLOW_DROP_BELOW_LEVEL策略
+        virtual void push(const char *data, size_t len, Log_level::level level) = 0;
+        virtual void stop() = 0;
+        // 屏障：等待调用前已写入(含转存到溢出文件)的日志全部交给回调处理完(工作器停止后不可调用)
+        virtual void flush() = 0;
+        // 因缓冲区已满被丢弃的日志条数(含溢出文件暂存区已满、写盘失败丢失的)
+        uint64_t dropped() { return _dropped + (_spill ? _spill->lost() : 0); }
+        // 转存到溢出文件的日志条数
+        uint64_t spilled() { return _spilled; }
+        LooperStats stats()
+        {
+            LooperStats st;
+            st._dropped = dropped();
+            st._spilled = _spilled.load(std::memory_order_relaxed);
+            st._batches = _batches.load(std::memory_order_relaxed);
+            st._batch_bytes = _batch_bytes.load(std::memory_order_relaxed);
+            st._max_batch = _max_batch.load(std::memory_order_relaxed);
+            st._blocked = _blocked.load(std::memory_order_relaxed);
+            st._blocked_ns = _blocked_ns.load(std::memory_order_relaxed);
+            fill(st._fill, st._capacity);
+            return st;
+        }
+
+    protected:
+        // 安全模式下缓冲区已满时按溢出策略处理(调用方持有lock)：
+        //  返回true表示已有空间可以写入，false表示本条已被丢弃或转存
+        template <typename Room, typename DropOldest>
+        bool onFull(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, Room room, DropOldest drop_oldest,
+                    const char *data, size_t len, Log_level::level level)
+        {
+            switch (_policy._type)
+            {
+            case OVERFLOW_DROP_NEWEST:
+                _dropped++;
+                return false;
+            case OVERFLOW_DROP_OLDEST:
+                _dropped += drop_oldest();
+                return true;
+            case OVERFLOW_DROP_BELOW_LEVEL:
+                if (level < _policy._keep_level)
+                {
+                    _dropped++;
+                    return false;
+                }
+                break;
+            case OVERFLOW_SPILL:
+                spill(data, len);
+                return false;
+            case OVERFLOW_BLOCK:
+                break;
+            }
+            uint64_t begin = Stats::Now();
+            bool ok = true;
+            if (_policy._timeout_ms == 0)
+            {
+                cond.wait(lock, room);
+            }
+            else
+            {
+                ok = cond.wait_for(lock, std::chrono::milliseconds(_policy._timeout_ms), room);
+            }
+            blocked(Stats::Now() - begin);
+            if (!ok)
+            {
+                _dropped++;
+            }
+            return ok;
+        }
+        void blocked(uint64_t ns)
         {
-            // 1.无限扩容（非安全） 2.固定大小--生产缓冲区满了就进行阻塞
+            _blocked++;
+            _blocked_ns += ns;
+        }
+        // 工作线程取出一批日志时记录批次大小(仅工作线程调用)
+        void onBatch(size_t bytes)
+        {
+            _batches.store(_batches.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            _batch_bytes.store(_batch_bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+            if (bytes > _max_batch.load(std::memory_order_relaxed))
+            {
+                _max_batch.store(bytes, std::memory_order_relaxed);
+            }
+        }
+        // 生产缓冲区当前占用的字节数与容量
+        virtual void fill(size_t &used, size_t &capacity) = 0;
+        void spill(const char *data, size_t len)
+        {
+            if (_spill->push(data, len))
+            {
+                _spilled++;
+                return;
+            }
+            _dropped++;
+        }
+        // 溢出文件转存进行中时直接写入溢出文件(保证顺序)，返回是否已转存
+        bool spilling(const char *data, size_t len)
+        {
+            if (!_spill || !_spill->active())
+            {
+                return false;
+            }
+            bool ok = true;
+            if (!_spill->pushIfActive(data, len, ok))
+            {
+                return false;
+            }
+            ok ? _spilled++ : _dropped++;
+            return true;
+        }
+        bool spillPending() { return _spill && _spill->active(); }
+        // 内存中的日志处理完后，从溢出文件读回下一批
+        bool drainSpill(Buffer &out) { return spillPending() && _spill->drain(out) > 0; }
+
+    protected:
+        OverflowPolicy _policy;
+        std::unique_ptr<SpillFile> _spill;
+        std::atomic<uint64_t> _dropped;
+        std::atomic<uint64_t> _spilled;
+        std::atomic<uint64_t> _batches;
+        std::atomic<uint64_t> _batch_bytes;
+        std::atomic<uint64_t> _max_batch;
+        std::atomic<uint64_t> _blocked;
+        std::atomic<uint64_t> _blocked_ns;
+    };
+
+    // 双缓冲区异步工作器
+    class DoubleBufferLooper : public AsyncLooper
+    {
+    public:
+        DoubleBufferLooper(const Functor &callback, AsyncLooper::AsyncType type = ASYNC_SAFE, const OverflowPolicy &policy = OverflowPolicy())
+            : AsyncLooper(policy), _stop(false), _pro_count(0), _taken(0), _done(0), _thread(std::thread(&DoubleBufferLooper::threadEntry, this)), _callback(callback), _looper_type(type) {}
+        ~DoubleBufferLooper() { stop(); }
+        void push(const char *data, size_t len, Log_level::level level) override
+        {
+            if (spilling(data, len))
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _con_cond.notify_all();
+                return;
+            }
+            // 1.无限扩容（非安全） 2.固定大小--生产缓冲区满了按溢出策略处理
             std::unique_lock<std::mutex> lock(_mutex);
-            // 若缓冲区剩余空间大小大于数据长度，则可以添加数据
-            if (_looper_type == ASYNC_SAFE)
+            // 若缓冲区剩余空间大小大于数据长度(或缓冲区为空)，则可以添加数据
+            auto room = [&]()
+            { return _pro_buf.empty() || _pro_buf.writeAbleSize() >= len; };
+            if (_looper_type == ASYNC_SAFE && !room())
             {
-                _pro_cond.wait(lock, [&]()
-                               { return _pro_buf.writeAbleSize() >= len; });
+                auto drop_oldest = [&]()
+                {
+                    size_t count = _pro_count;
+                    _pro_buf.reset();
+                    _pro_count = 0;
+                    return count;
+                };
+                if (!onFull(lock, _pro_cond, room, drop_oldest, data, len, level))
+                {
+                    _con_cond.notify_all();
+                    return;
+                }
             }
             _pro_buf.push(data, len);
+            _pro_count++;
             // 唤醒消费者对缓冲区的数据进行处理
             _con_cond.notify_all();
         }
-        void stop()
+        void stop() override
         {
             _stop = true;
             _con_cond.notify_all();
-            _thread.join(); // 等待工作线程结束
+            if (_thread.joinable())
+            {
+                _thread.join(); // 等待工作线程结束
+            }
+        }
+        // 生产缓冲区中有数据(或溢出文件未读完)时等待工作线程再取走并处理完一轮，否则只等待正在处理的一轮；
+        //  有转存的日志时重复等待，直到溢出文件读完且读回的一轮也处理完
+        void flush() override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            bool spill;
+            do
+            {
+                spill = spillPending();
+                uint64_t target = _taken + (_pro_buf.empty() && !spill ? 0 : 1);
+                _con_cond.notify_all();
+                _flush_cond.wait(lock, [&]()
+                                 { return _done >= target; });
+            } while (spill && (spillPending() || _taken > _done));
+        }
+
+    protected:
+        void fill(size_t &used, size_t &capacity) override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            used = _pro_buf.readAbleSize();
+            capacity = _pro_buf.readAbleSize() + _pro_buf.writeAbleSize();
         }
 
     private:
         // 线程入口函数
         void threadEntry()
-        {  
-            while (!_stop|| !_pro_buf.empty())
+        {
+            while (!_stop|| !_pro_buf.empty() || spillPending())
             {
+                bool spill = false;
                 {
                     std::unique_lock<std::mutex> lock(_mutex);
                     // 1.判断生产缓冲区是否有数据，有则交换，无则阻塞
                     // 退出前被唤醒或有数据被唤醒
                     _con_cond.wait(lock, [&]()
-                                   { return _stop || !_pro_buf.empty(); });
+                                   { return _stop || !_pro_buf.empty() || spillPending(); });
+                    // 内存中的日志都处理完后才读回溢出文件
+                    spill = _pro_buf.empty();
                     _con_buf.swap(_pro_buf);
+                    _pro_count = 0;
+                    _taken++;
                     // 2.唤醒生产者
                     if (_looper_type == ASYNC_SAFE)
                     {
-                        _pro_cond.notify_one();
+                        _pro_cond.notify_all();
                     }
                 }
+                if (spill)
+                {
+                    drainSpill(_con_buf);
+                }
                 // 3.唤醒后对消费者缓冲区进行处理
-                _callback(_con_buf);
+                if (!_con_buf.empty())
+                {
+                    onBatch(_con_buf.readAbleSize());
+                    _callback(_con_buf);
+                }
                 // 4.初始化消费者缓冲区
                 _con_buf.reset();
+                std::unique_lock<std::mutex> lock(_mutex);
+                _done++;
+                _flush_cond.notify_all();
             }
         }
 
@@ -79,10 +294,523 @@ namespace log_master
         std::atomic<bool> _stop; // 工作器停止标志
         Buffer _pro_buf;         // 生产者缓冲区
         Buffer _con_buf;         // 消费者缓冲区
+        size_t _pro_count;       // 生产者缓冲区中的日志条数
+        uint64_t _taken;         // 工作线程取走的轮数(受_mutex保护，下同)
+        uint64_t _done;          // 处理完的轮数
+        std::mutex _mutex;
+        std::condition_variable _pro_cond;
+        std::condition_variable _con_cond;
+        std::condition_variable _flush_cond;
+        std::thread _thread; // 异步工作器对应工作线程
+    };
+
+    // 无锁环形缓冲区异步工作器
+    //  生产者:CAS预留空间+拷贝，只有工作线程休眠时才加锁唤醒
+    //  ASYNC_SAFE:环形缓冲区满时按溢出策略处理(已发布的日志不能由生产者撤回，OVERFLOW_DROP_OLDEST按丢弃本条处理)
+    //  ASYNC_NOSAFE:环形缓冲区满时写入加锁的溢出缓冲区(无限扩容)，不阻塞
+    class RingLooper : public AsyncLooper
+    {
+    public:
+        RingLooper(const Functor &callback, AsyncLooper::AsyncType type = ASYNC_SAFE, const OverflowPolicy &policy = OverflowPolicy(), size_t capacity = DEFAULT_RING_SIZE)
+            : AsyncLooper(policy), _callback(callback), _looper_type(type), _ring(capacity), _stop(false), _sleeping(false), _pro_waiters(0), _has_overflow(false),
+              _overflow_seq(0), _overflow_done(0), _done_pos(0), _flush_waiters(0), _draining(false), _thread(std::thread(&RingLooper::threadEntry, this)) {}
+        ~RingLooper() { stop(); }
+        void push(const char *data, size_t len, Log_level::level level) override
+        {
+            if (spilling(data, len))
+            {
+                wakeConsumer();
+                return;
+            }
+            // 单条超过环形缓冲区容量的日志只能走溢出缓冲区，否则会永久阻塞
+            if (!_ring.fits(len))
+            {
+                pushOverflow(data, len);
+                return;
+            }
+            std::chrono::steady_clock::time_point deadline;
+            bool timed = false;
+            while (!_ring.tryPush(data, len))
+            {
+                if (_looper_type == ASYNC_NOSAFE)
+                {
+                    pushOverflow(data, len);
+                    return;
+                }
+                // 安全模式：缓冲区满，按溢出策略丢弃/转存或阻塞等待工作线程归还空间
+                if (_policy._type == OVERFLOW_DROP_NEWEST || _policy._type == OVERFLOW_DROP_OLDEST ||
+                    (_policy._type == OVERFLOW_DROP_BELOW_LEVEL && level < _policy._keep_level))
+                {
+                    _dropped++;
+                    return;
+                }
+                if (_policy._type == OVERFLOW_SPILL)
+                {
+                    spill(data, len);
+                    wakeConsumer();
+                    return;
+                }
+                if (_policy._timeout_ms != 0)
+                {
+                    if (!timed)
+                    {
+                        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_policy._timeout_ms);
+                        timed = true;
+                    }
+                    else if (std::chrono::steady_clock::now() >= deadline)
+                    {
+                        _dropped++;
+                        return;
+                    }
+                }
+                uint64_t begin = Stats::Now();
+                std::unique_lock<std::mutex> lock(_mutex);
+                _pro_waiters++;
+                _pro_cond.wait_for(lock, std::chrono::milliseconds(1), [&]()
+                                   { return _ring.writeAble(len); });
+                _pro_waiters--;
+                lock.unlock();
+                blocked(Stats::Now() - begin);
+            }
+            wakeConsumer();
+        }
+        void stop() override
+        {
+            _stop = true;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _con_cond.notify_all();
+            }
+            if (_thread.joinable())
+            {
+                _thread.join();
+            }
+        }
+        // 等待工作线程处理完调用时已预留的环形缓冲区位置、已写入的溢出缓冲区与溢出文件
+        void flush() override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _flush_waiters.fetch_add(1, std::memory_order_seq_cst);
+            uint64_t pos = _ring.writePos();
+            uint64_t seq = _overflow_seq;
+            _con_cond.notify_one();
+            _flush_cond.wait(lock, [&]()
+                             { return _done_pos.load(std::memory_order_seq_cst) >= pos && _overflow_done >= seq && !_draining && !spillPending(); });
+            _flush_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+    protected:
+        void fill(size_t &used, size_t &capacity) override
+        {
+            used = _ring.size();
+            capacity = _ring.capacity();
+        }
+
+    private:
+        void pushOverflow(const char *data, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _overflow.push(data, len);
+            _overflow_seq++;
+            _has_overflow = true;
+            _con_cond.notify_one();
+        }
+        void wakeConsumer()
+        {
+            // 与threadEntry中对_sleeping的写入配对，避免丢失唤醒
+            if (_sleeping.load(std::memory_order_seq_cst))
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _con_cond.notify_one();
+            }
+        }
+        bool idle()
+        {
+            return _ring.empty() && !_has_overflow && !spillPending();
+        }
+        // 记录已处理完的位置，有等待的flush()时唤醒(与flush中对_flush_waiters的写入配对，避免丢失唤醒)
+        void done(uint64_t pos, uint64_t seq)
+        {
+            _done_pos.store(pos, std::memory_order_seq_cst);
+            if (_flush_waiters.load(std::memory_order_seq_cst) > 0)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (seq > _overflow_done)
+                {
+                    _overflow_done = seq;
+                }
+                _flush_cond.notify_all();
+            }
+            else if (seq != 0)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _overflow_done = seq;
+            }
+        }
+        // 读回溢出文件期间flush()不能只凭溢出文件已读完返回
+        void setDraining(bool draining)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _draining = draining;
+            if (!draining)
+            {
+                _flush_cond.notify_all();
+            }
+        }
+        void threadEntry()
+        {
+            while (!_stop || !idle())
+            {
+                // 1.从环形缓冲区取出已发布的日志，归还空间后唤醒等待的生产者
+                size_t count = _ring.popTo(_con_buf, DEFAULT_BUFFER_SIZE);
+                uint64_t pos = _ring.readPos();
+                uint64_t seq = 0;
+                if (count > 0 && _pro_waiters.load() > 0)
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _pro_cond.notify_all();
+                }
+                // 2.取出溢出缓冲区中的日志
+                if (_has_overflow)
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _con_buf.push(_overflow.begin(), _overflow.readAbleSize());
+                    _overflow.reset();
+                    _has_overflow = false;
+                    seq = _overflow_seq;
+                }
+                if (!_con_buf.empty())
+                {
+                    onBatch(_con_buf.readAbleSize());
+                    _callback(_con_buf);
+                    _con_buf.reset();
+                    done(pos, seq);
+                    continue;
+                }
+                done(pos, seq);
+                // 3.已预留但尚未发布，稍后重试
+                if (!_ring.empty())
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // 4.内存中的日志处理完后读回溢出文件
+                if (spillPending())
+                {
+                    setDraining(true);
+                    bool drained = drainSpill(_con_buf);
+                    if (drained)
+                    {
+                        onBatch(_con_buf.readAbleSize());
+                        _callback(_con_buf);
+                        _con_buf.reset();
+                    }
+                    setDraining(false);
+                    if (drained)
+                    {
+                        continue;
+                    }
+                }
+                // 5.无数据则休眠
+                std::unique_lock<std::mutex> lock(_mutex);
+                _sleeping.store(true, std::memory_order_seq_cst);
+                _con_cond.wait_for(lock, std::chrono::milliseconds(100), [&]()
+                                   { return _stop || !idle(); });
+                _sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        Functor _callback; // 回调函数
+        AsyncType _looper_type;
+        RingBuffer _ring;               // 生产者写入的无锁环形缓冲区
+        Buffer _con_buf;                // 消费者缓冲区
+        Buffer _overflow;               // 溢出缓冲区(受_mutex保护)
+        std::atomic<bool> _stop;        // 工作器停止标志
+        std::atomic<bool> _sleeping;    // 工作线程是否处于休眠
+        std::atomic<int> _pro_waiters;  // 阻塞等待空间的生产者数量
+        std::atomic<bool> _has_overflow;
+        uint64_t _overflow_seq;           // 写入溢出缓冲区的次数(受_mutex保护，下同)
+        uint64_t _overflow_done;          // 已处理完的溢出缓冲区写入次数
+        std::atomic<uint64_t> _done_pos;  // 已处理完的环形缓冲区位置
+        std::atomic<int> _flush_waiters;  // 等待中的flush()调用数
+        bool _draining;                   // 正在读回并处理溢出文件(受_mutex保护)
         std::mutex _mutex;
         std::condition_variable _pro_cond;
         std::condition_variable _con_cond;
+        std::condition_variable _flush_cond;
         std::thread _thread; // 异步工作器对应工作线程
     };
 
-}
\ No newline at end of file
+    class PooledLooper;
+    // 共享后台线程池：固定数量的工作线程服务所有LOOPER_SHARED异步工作器
+    //  每个工作线程有自己的就绪队列，有数据的工作器被放入队列，每次只处理一批后排到队尾(轮转调度)；
+    //  自己的队列为空时从其他线程的队尾窃取
+    class BackendPool
+    {
+    public:
+        using ptr = std::shared_ptr<BackendPool>;
+        BackendPool(size_t threads) : _queues(threads == 0 ? 1 : threads), _pending(0), _next(0), _stop(false)
+        {
+            for (size_t i = 0; i < _queues.size(); i++)
+            {
+                _threads.emplace_back(&BackendPool::threadEntry, this, i);
+            }
+        }
+        ~BackendPool()
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true;
+                _cond.notify_all();
+            }
+            for (auto &t : _threads)
+            {
+                t.join();
+            }
+        }
+        size_t threads() { return _threads.size(); }
+        // 为新的工作器分配一个所属线程
+        size_t assign() { return _next++ % _queues.size(); }
+        // 将有数据的工作器放入idx号线程的就绪队列
+        //  入队与_pending++都在_mutex内完成：取出该工作器的线程要拿到_mutex才能_pending--，计数不会先减后加
+        void schedule(PooledLooper *looper, size_t idx)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            {
+                std::unique_lock<std::mutex> qlock(_queues[idx]._mutex);
+                _queues[idx]._ready.push_back(looper);
+            }
+            _pending++;
+            _cond.notify_one();
+        }
+
+    private:
+        struct ReadyQueue
+        {
+            std::mutex _mutex;
+            std::deque<PooledLooper *> _ready; // 工作器在处理完之前不会析构(见PooledLooper::stop)
+        };
+        PooledLooper *take(size_t idx)
+        {
+            while (true)
+            {
+                PooledLooper *looper = nullptr;
+                // 先取自己队列的队首，再从其他队列的队尾窃取
+                for (size_t i = 0; i < _queues.size() && !looper; i++)
+                {
+                    ReadyQueue &q = _queues[(idx + i) % _queues.size()];
+                    std::unique_lock<std::mutex> lock(q._mutex);
+                    if (q._ready.empty())
+                    {
+                        continue;
+                    }
+                    if (i == 0)
+                    {
+                        looper = q._ready.front();
+                        q._ready.pop_front();
+                    }
+                    else
+                    {
+                        looper = q._ready.back();
+                        q._ready.pop_back();
+                    }
+                }
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (looper != nullptr)
+                {
+                    _pending--;
+                    return looper;
+                }
+                if (_stop && _pending == 0)
+                {
+                    return nullptr;
+                }
+                _cond.wait(lock, [&]()
+                           { return _stop || _pending > 0; });
+            }
+        }
+        void threadEntry(size_t idx);
+
+    private:
+        std::vector<ReadyQueue> _queues;
+        size_t _pending; // 所有就绪队列中的工作器总数(受_mutex保护)
+        std::atomic<size_t> _next;
+        bool _stop;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::vector<std::thread> _threads;
+    };
+
+    // 由共享后台线程池服务的异步工作器：只有一对按需扩容的小缓冲区，没有独立线程
+    class PooledLooper : public AsyncLooper
+    {
+    public:
+        PooledLooper(const Functor &callback, AsyncLooper::AsyncType type, BackendPool::ptr pool, const OverflowPolicy &policy = OverflowPolicy())
+            : AsyncLooper(policy), _callback(callback), _looper_type(type), _pool(pool), _home(pool->assign()),
+              _pro_buf(POOLED_BUFFER_SIZE), _con_buf(POOLED_BUFFER_SIZE), _pro_count(0), _taken(0), _done(0), _scheduled(false) {}
+        ~PooledLooper() { stop(); }
+        void push(const char *data, size_t len, Log_level::level level) override
+        {
+            bool schedule = false;
+            if (spilling(data, len))
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                schedule = markScheduled();
+            }
+            else
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                // 安全模式：缓冲区达到上限时按溢出策略处理(单条超过上限的日志在缓冲区为空时放行)
+                auto room = [&]()
+                { return _pro_buf.empty() || _pro_buf.readAbleSize() + len <= DEFAULT_BUFFER_SIZE; };
+                auto drop_oldest = [&]()
+                {
+                    size_t count = _pro_count;
+                    _pro_buf.reset();
+                    _pro_count = 0;
+                    return count;
+                };
+                if (_looper_type == ASYNC_NOSAFE || room() || onFull(lock, _pro_cond, room, drop_oldest, data, len, level))
+                {
+                    _pro_buf.push(data, len);
+                    _pro_count++;
+                }
+                if (!_pro_buf.empty() || spillPending())
+                {
+                    schedule = markScheduled();
+                }
+            }
+            if (schedule)
+            {
+                _pool->schedule(this, _home);
+            }
+        }
+        // 等待已写入的日志全部处理完，此后工作线程不再访问本对象
+        void stop() override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _idle_cond.wait(lock, [&]()
+                            { return !_scheduled; });
+        }
+        // 同DoubleBufferLooper::flush
+        void flush() override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            bool spill;
+            do
+            {
+                spill = spillPending();
+                uint64_t target = _taken + (_pro_buf.empty() && !spill ? 0 : 1);
+                _idle_cond.wait(lock, [&]()
+                                { return _done >= target; });
+            } while (spill && (spillPending() || _taken > _done));
+        }
+        // 由工作线程调用：处理一批日志，返回是否还有数据需要再次调度
+        bool runOnce()
+        {
+            bool spill = false;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                // 内存中的日志都处理完后才读回溢出文件
+                spill = _pro_buf.empty();
+                _con_buf.swap(_pro_buf);
+                _pro_count = 0;
+                _taken++;
+                if (_looper_type == ASYNC_SAFE)
+                {
+                    _pro_cond.notify_all();
+                }
+            }
+            if (spill)
+            {
+                drainSpill(_con_buf);
+            }
+            if (!_con_buf.empty())
+            {
+                onBatch(_con_buf.readAbleSize());
+                _callback(_con_buf);
+                _con_buf.reset();
+            }
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done++;
+            _idle_cond.notify_all();
+            if (!_pro_buf.empty() || spillPending())
+            {
+                return true;
+            }
+            _scheduled = false;
+            return false;
+        }
+
+    protected:
+        void fill(size_t &used, size_t &capacity) override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            used = _pro_buf.readAbleSize();
+            capacity = DEFAULT_BUFFER_SIZE;
+        }
+
+    private:
+        // 尚未调度时标记为已调度，返回是否需要放入就绪队列(调用方持有_mutex)
+        bool markScheduled()
+        {
+            if (_scheduled)
+            {
+                return false;
+            }
+            _scheduled = true;
+            return true;
+        }
+
+    private:
+        Functor _callback;
+        AsyncType _looper_type;
+        BackendPool::ptr _pool;
+        size_t _home;    // 所属工作线程
+        Buffer _pro_buf; // 生产者缓冲区
+        Buffer _con_buf; // 消费者缓冲区
+        size_t _pro_count; // 生产者缓冲区中的日志条数
+        uint64_t _taken;   // 取走的轮数(受_mutex保护，下同)
+        uint64_t _done;    // 处理完的轮数
+        bool _scheduled; // 是否在就绪队列中或正在被处理(受_mutex保护)
+        std::mutex _mutex;
+        std::condition_variable _pro_cond;
+        std::condition_variable _idle_cond;
+    };
+
+    inline void BackendPool::threadEntry(size_t idx)
+    {
+        while (true)
+        {
+            PooledLooper *looper = take(idx);
+            if (looper == nullptr)
+            {
+                break;
+            }
+            if (looper->runOnce())
+            {
+                schedule(looper, idx);
+            }
+        }
+    }
+
+    class LooperFactory
+    {
+    public:
+        static AsyncLooper::ptr Create(LooperEngine engine, const Functor &callback, AsyncLooper::AsyncType type,
+                                       const OverflowPolicy &policy = OverflowPolicy(), BackendPool::ptr pool = BackendPool::ptr())
+        {
+            if (engine == LOOPER_SHARED)
+            {
+                assert(pool);
+                return std::make_shared<PooledLooper>(callback, type, pool, policy);
+            }
+            if (engine == LOOPER_RING)
+            {
+                return std::make_shared<RingLooper>(callback, type, policy);
+            }
+            return std::make_shared<DoubleBufferLooper>(callback, type, policy);
+        }
+    };
+}
@@ -1,7 +1,13 @@
-#pragma once 
+#pragma once
+/*日志消息：LogMsg只在一次日志调用(或一次解码回调)内使用，文件名、日志器名称、有效载荷与结构化字段
+  都是不持有内容的视图，内容由调用方持有(文件名为字面量、名称属于日志器、有效载荷在调用方的FmtStr::Writer中)，
+  构造LogMsg不分配堆内存；需要跨调用保存时由使用方自行复制*/
 
 #include <iostream>
+#include <string>
+#include <cstring>
 #include <thread>
+#include <cstdint>
 
 #include "./log_level.hpp"
 #include "./util.hpp"
@@ -11,17 +17,47 @@ namespace log_master
     class Message
     {
         public:
+        // 不持有内容的字符串视图(C++11没有std::string_view)
+        class StrView
+        {
+        public:
+            StrView() : _data(""), _size(0) {}
+            StrView(const char *s) : _data(s == nullptr ? "" : s), _size(s == nullptr ? 0 : strlen(s)) {}
+            StrView(const char *s, size_t len) : _data(s), _size(len) {}
+            StrView(const std::string &s) : _data(s.data()), _size(s.size()) {}
+            const char *data() const { return _data; }
+            size_t size() const { return _size; }
+            bool empty() const { return _size == 0; }
+            std::string str() const { return std::string(_data, _size); }
+
+        private:
+            const char *_data;
+            size_t _size;
+        };
+
         struct LogMsg
         {
             size_t _line;                        // 行号
-            time_t _ctime;                       // 时间
+            time_t _ctime;                       // 时间(秒)
+            uint32_t _nsec;                      // 时间的亚秒部分(纳秒)
             std::thread::id _tid;                // 线程ID
-            std::string _name;                   // 日志器名称
-            std::string _file;                   // 文件名
-            std::string _payload;                // 日志消息
+            StrView _name;                       // 日志器名称
+            StrView _file;                       // 文件名
+            StrView _payload;                    // 日志消息
+            StrView _fields;                     // 结构化字段(编码格式见structured.hpp，普通日志为空)
             log_master::Log_level::level _level; // 日志等级
 
-            LogMsg(log_master::Log_level::level level, size_t line, std::string file, std::string name, std::string payload) : _level(level), _line(line), _name(name), _tid(std::this_thread::get_id()), _ctime(log_master::Util::Date::getTime()), _file(file), _payload(payload) {}
+            LogMsg(log_master::Log_level::level level, size_t line, StrView file, StrView name, StrView payload) : LogMsg(level, line, file, name, payload, log_master::Util::Clock::Now()) {}
+            // ns:自1970年以来的纳秒数(由日志器按其时钟源采集)
+            LogMsg(log_master::Log_level::level level, size_t line, StrView file, StrView name, StrView payload, uint64_t ns) : _line(line), _tid(std::this_thread::get_id()), _name(name), _file(file), _payload(payload), _level(level)
+            {
+                setTime(ns);
+            }
+            void setTime(uint64_t ns)
+            {
+                _ctime = (time_t)(ns / 1000000000ull);
+                _nsec = (uint32_t)(ns % 1000000000ull);
+            }
         };
     };
-}
\ No newline at end of file
+}
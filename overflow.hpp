@@ -0,0 +1,298 @@
+#pragma once
+/*异步工作器的溢出策略：安全模式下生产缓冲区已满时如何处理新日志
+    OVERFLOW_BLOCK:阻塞等待空间(可设置超时，超时后丢弃本条)
+    OVERFLOW_DROP_NEWEST:丢弃本条
+    OVERFLOW_DROP_OLDEST:丢弃缓冲区中尚未被工作线程取走的全部日志
+    OVERFLOW_DROP_BELOW_LEVEL:丢弃低于指定等级的日志，其余阻塞等待
+    OVERFLOW_SPILL:转存到磁盘上的溢出文件，工作线程处理完内存中的日志后按顺序读回*/
+#include <iostream>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "./log_level.hpp"
+#include "./buffer.hpp"
+#include "./util.hpp"
+
+namespace log_master
+{
+    #define SPILL_READ_SIZE 1024*1024  // 每次从溢出文件读回的大小
+    #define SPILL_QUEUE_SIZE 4*1024*1024 // 溢出文件等待写盘的暂存区上限
+    #define DROP_REPORT_INTERVAL 1     // "N messages dropped"记录的最小间隔(秒)
+
+    enum OverflowType
+    {
+        OVERFLOW_BLOCK,
+        OVERFLOW_DROP_NEWEST,
+        OVERFLOW_DROP_OLDEST,
+        OVERFLOW_DROP_BELOW_LEVEL,
+        OVERFLOW_SPILL
+    };
+
+    struct OverflowPolicy
+    {
+        OverflowType _type = OVERFLOW_BLOCK;
+        uint32_t _timeout_ms = 0;                          // 阻塞等待的超时时间(0表示一直等待)
+        Log_level::level _keep_level = Log_level::WARNING; // OVERFLOW_DROP_BELOW_LEVEL保留的最低等级
+        std::string _spill_path;                           // OVERFLOW_SPILL的溢出文件
+
+        static OverflowPolicy Block(uint32_t timeout_ms = 0)
+        {
+            OverflowPolicy p;
+            p._timeout_ms = timeout_ms;
+            return p;
+        }
+        static OverflowPolicy DropNewest()
+        {
+            OverflowPolicy p;
+            p._type = OVERFLOW_DROP_NEWEST;
+            return p;
+        }
+        static OverflowPolicy DropOldest()
+        {
+            OverflowPolicy p;
+            p._type = OVERFLOW_DROP_OLDEST;
+            return p;
+        }
+        static OverflowPolicy DropBelow(Log_level::level keep_level = Log_level::WARNING, uint32_t timeout_ms = 0)
+        {
+            OverflowPolicy p;
+            p._type = OVERFLOW_DROP_BELOW_LEVEL;
+            p._keep_level = keep_level;
+            p._timeout_ms = timeout_ms;
+            return p;
+        }
+        static OverflowPolicy Spill(const std::string &spill_path)
+        {
+            OverflowPolicy p;
+            p._type = OVERFLOW_SPILL;
+            p._spill_path = spill_path;
+            return p;
+        }
+    };
+
+    // 溢出文件：记录格式为[4字节长度][数据]
+    //  一旦开始转存，后续日志都写入溢出文件(保证顺序)，直到工作线程全部读回后才重新写入内存
+    //  生产者只把记录追加到有上限的内存暂存区(SPILL_QUEUE_SIZE)，由溢出文件自己的线程写盘，生产者不做磁盘IO；
+    //  暂存区已满或写盘失败的记录被丢弃并计数(都计入AsyncLooper::dropped)
+    class SpillFile
+    {
+    public:
+        SpillFile(const std::string &pathname)
+            : _pathname(pathname), _write_off(0), _read_off(0), _writing(false), _stop(false), _active(false), _lost(0)
+        {
+            Util::File::CreateDirectory(Util::File::Path(_pathname));
+            _fd = ::open(_pathname.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            assert(_fd >= 0);
+            _thread = std::thread(&SpillFile::threadEntry, this);
+        }
+        ~SpillFile()
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true;
+                _cond.notify_all();
+            }
+            _thread.join();
+            if (_fd >= 0)
+            {
+                ::close(_fd);
+            }
+            if (!_active)
+            {
+                unlink(_pathname.c_str());
+            }
+        }
+        bool active() { return _active.load(std::memory_order_acquire); }
+        // 已接受但写盘或读回失败而丢失的记录数(暂存区已满时push返回false，由调用方计数)
+        uint64_t lost() { return _lost.load(std::memory_order_relaxed); }
+        // 转存一条日志，暂存区已满返回false
+        bool push(const char *data, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return append(data, len);
+        }
+        // 仅在转存进行中时写入(保证同一线程的日志顺序)
+        bool pushIfActive(const char *data, size_t len, bool &ok)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (!_active)
+            {
+                return false;
+            }
+            ok = append(data, len);
+            return true;
+        }
+        // 读回完整的记录追加到out，全部读回后截断文件并结束转存；返回读回的记录数
+        //  先等待正在写盘的一批写完(最多一个暂存区)，文件已读完时仍未写盘的暂存记录直接交给out
+        size_t drain(Buffer &out)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [&]()
+                       { return !_writing; });
+            size_t count = 0;
+            if (_read_off == _write_off)
+            {
+                count = Parse(_staged.data(), _staged.size(), out);
+                _staged.clear();
+                finish();
+                return count;
+            }
+            size_t want = std::min((size_t)(_write_off - _read_off), (size_t)SPILL_READ_SIZE);
+            _chunk.resize(want);
+            if (pread(_fd, &_chunk[0], want, _read_off) != (ssize_t)want)
+            {
+                _lost += Count(_staged.data(), _staged.size());
+                _staged.clear();
+                finish();
+                return 0;
+            }
+            size_t pos = 0;
+            count = Parse(&_chunk[0], want, out, &pos);
+            if (pos == 0)
+            {
+                // 单条记录超过读取块大小
+                uint32_t len;
+                memcpy(&len, &_chunk[0], sizeof(len));
+                _chunk.resize(sizeof(len) + len);
+                if (pread(_fd, &_chunk[0], _chunk.size(), _read_off) == (ssize_t)_chunk.size())
+                {
+                    out.push(&_chunk[sizeof(len)], len);
+                    pos = _chunk.size();
+                    count++;
+                }
+                else
+                {
+                    pos = _write_off - _read_off;
+                    _lost++;
+                }
+            }
+            _read_off += pos;
+            if (_read_off == _write_off && _staged.empty())
+            {
+                finish();
+            }
+            return count;
+        }
+
+    private:
+        // 把buf中完整的记录追加到out，end返回已解析的长度
+        static size_t Parse(const char *buf, size_t len, Buffer &out, size_t *end = nullptr)
+        {
+            size_t count = 0, pos = 0;
+            uint32_t n;
+            while (len - pos >= sizeof(n))
+            {
+                memcpy(&n, buf + pos, sizeof(n));
+                if (len - pos - sizeof(n) < n)
+                {
+                    break;
+                }
+                out.push(buf + pos + sizeof(n), n);
+                pos += sizeof(n) + n;
+                count++;
+            }
+            if (end != nullptr)
+            {
+                *end = pos;
+            }
+            return count;
+        }
+        static size_t Count(const char *buf, size_t len)
+        {
+            size_t count = 0, pos = 0;
+            uint32_t n;
+            while (len - pos >= sizeof(n))
+            {
+                memcpy(&n, buf + pos, sizeof(n));
+                pos += sizeof(n) + n;
+                count++;
+            }
+            return count;
+        }
+        // 追加到暂存区(调用方持有_mutex)，暂存区为空时单条超过上限的记录也放行
+        bool append(const char *data, size_t len)
+        {
+            uint32_t head = (uint32_t)len;
+            if (!_staged.empty() && _staged.size() + sizeof(head) + len > SPILL_QUEUE_SIZE)
+            {
+                return false;
+            }
+            _staged.insert(_staged.end(), (const char *)&head, (const char *)&head + sizeof(head));
+            _staged.insert(_staged.end(), data, data + len);
+            _active.store(true, std::memory_order_release);
+            _cond.notify_all();
+            return true;
+        }
+        void finish()
+        {
+            if (ftruncate(_fd, 0) != 0)
+            {
+                std::cout << "截断溢出文件失败" << std::endl;
+            }
+            _write_off = _read_off = 0;
+            _active.store(false, std::memory_order_release);
+        }
+        // 写盘线程：每次取走整个暂存区写到文件末尾(退出前写完剩余的暂存记录)
+        void threadEntry()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                _cond.wait(lock, [&]()
+                           { return _stop || !_staged.empty(); });
+                if (_staged.empty())
+                {
+                    return;
+                }
+                _flushing.swap(_staged);
+                off_t off = _write_off;
+                _writing = true;
+                lock.unlock();
+                ssize_t ret = pwrite(_fd, &_flushing[0], _flushing.size(), off);
+                lock.lock();
+                _writing = false;
+                if (ret == (ssize_t)_flushing.size())
+                {
+                    _write_off += ret;
+                }
+                else
+                {
+                    _lost += Count(_flushing.data(), _flushing.size());
+                    if (_read_off == _write_off && _staged.empty())
+                    {
+                        finish();
+                    }
+                }
+                _flushing.clear();
+                _cond.notify_all();
+            }
+        }
+
+    private:
+        std::string _pathname;
+        int _fd;
+        off_t _write_off;
+        off_t _read_off;
+        std::vector<char> _staged;   // 等待写盘的记录
+        std::vector<char> _flushing; // 正在写盘的记录(仅写盘线程使用)
+        bool _writing;
+        bool _stop;
+        std::atomic<bool> _active; // 是否有尚未读回的记录(含暂存区中的)
+        std::atomic<uint64_t> _lost;
+        std::vector<char> _chunk; // 读回缓冲区(仅工作线程使用)
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::thread _thread;
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+/*调用点级别的限流与采样(通过bitlog.h中的xxx_limited/xxx_sampled宏使用)
+    1.每个调用点的状态是宏展开的lambda中的静态对象，无锁：
+      TokenBucket按GCRA(理论到达时间)实现令牌桶，一次CAS；Sampler每N条放行1条，一次原子加
+    2.被拒绝时不求值参数、不格式化，只计数
+    3.通过时把此前被拒绝的条数放入线程局部的Pending，日志器构造LogMsg时作为结构化字段suppressed=N附带输出*/
+#include <atomic>
+#include <cstdint>
+#include <cassert>
+#include <time.h>
+
+namespace log_master
+{
+    namespace RateLimit
+    {
+        // 粗粒度单调时钟(vdso读取，无系统调用)，精度为一个时钟节拍，足够用于限流
+        inline uint64_t CoarseNow()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        }
+
+        // 令牌桶：平均每秒rate条，最多连续放行burst条
+        class TokenBucket
+        {
+        public:
+            TokenBucket(double rate, uint32_t burst = 1) : _tat(0), _suppressed(0)
+            {
+                assert(rate > 0);
+                _interval = (uint64_t)(1e9 / rate);
+                _tolerance = _interval * (burst > 1 ? burst - 1 : 0);
+            }
+            // 放行时suppressed为上次放行以来被拒绝的条数
+            bool allow(uint64_t &suppressed)
+            {
+                uint64_t now = CoarseNow();
+                uint64_t tat = _tat.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    uint64_t base = tat > now ? tat : now;
+                    if (base - now > _tolerance)
+                    {
+                        _suppressed.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    if (_tat.compare_exchange_weak(tat, base + _interval, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                suppressed = _suppressed.load(std::memory_order_relaxed) == 0 ? 0 : _suppressed.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+
+        private:
+            uint64_t _interval;         // 每条的间隔(纳秒)
+            uint64_t _tolerance;        // 允许提前的时间(burst-1个间隔)
+            std::atomic<uint64_t> _tat; // 理论到达时间
+            std::atomic<uint64_t> _suppressed;
+        };
+
+        // 采样：每n条放行第1条
+        class Sampler
+        {
+        public:
+            Sampler(uint64_t n) : _n(n == 0 ? 1 : n), _count(0) {}
+            bool allow(uint64_t &suppressed)
+            {
+                uint64_t c = _count.fetch_add(1, std::memory_order_relaxed);
+                if (c % _n != 0)
+                {
+                    return false;
+                }
+                suppressed = c == 0 ? 0 : _n - 1;
+                return true;
+            }
+
+        private:
+            uint64_t _n;
+            std::atomic<uint64_t> _count;
+        };
+
+        // 放行的这条日志需要附带的被拒绝条数(仅在宏展开的作用域内有效)
+        class Pending
+        {
+        public:
+            Pending(uint64_t n) { Count() = n; }
+            ~Pending() { Count() = 0; }
+            static uint64_t &Count()
+            {
+                static thread_local uint64_t n = 0;
+                return n;
+            }
+        };
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+/*无锁多生产者单消费者(MPSC)环形缓冲区
+    1.生产者通过CAS预留空间，拷贝数据后发布记录头，全程不加锁
+    2.消费者按顺序取出已发布的记录，写入消费者Buffer后归还空间
+    记录格式: [8字节记录头(数据长度+1,0表示未发布)][数据(按8字节对齐)]
+*/
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "./buffer.hpp"
+
+namespace log_master
+{
+    #define DEFAULT_RING_SIZE 8*1024*1024
+    class RingBuffer
+    {
+    public:
+        RingBuffer(size_t capacity = DEFAULT_RING_SIZE) : _capacity(RoundUp(capacity)), _mask(_capacity - 1), _ring(_capacity, 0), _write_pos(0), _read_pos(0) {}
+        // 单条记录是否能放入环形缓冲区
+        bool fits(size_t len)
+        {
+            return RecordSize(len) <= _capacity;
+        }
+        // 尝试写入一条记录，空间不足返回false
+        bool tryPush(const char *data, size_t len)
+        {
+            size_t need = RecordSize(len);
+            uint64_t pos = _write_pos.load(std::memory_order_relaxed);
+            do
+            {
+                if (pos + need - _read_pos.load(std::memory_order_acquire) > _capacity)
+                {
+                    return false;
+                }
+            } while (!_write_pos.compare_exchange_weak(pos, pos + need, std::memory_order_seq_cst, std::memory_order_relaxed));
+            // 先拷贝数据，再发布记录头
+            copyIn(pos + HEADER_SIZE, data, len);
+            __atomic_store_n(header(pos), (uint32_t)(len + 1), __ATOMIC_RELEASE);
+            return true;
+        }
+        // 当前剩余空间能否放下len字节的记录
+        bool writeAble(size_t len)
+        {
+            return _write_pos.load(std::memory_order_relaxed) + RecordSize(len) - _read_pos.load(std::memory_order_acquire) <= _capacity;
+        }
+        // 消费者:取出已发布的记录写入buffer，最多取max_bytes，返回取出的记录数
+        size_t popTo(Buffer &buffer, size_t max_bytes)
+        {
+            size_t count = 0, bytes = 0;
+            uint64_t pos = _read_pos.load(std::memory_order_relaxed);
+            while (bytes < max_bytes)
+            {
+                uint32_t tag = __atomic_load_n(header(pos), __ATOMIC_ACQUIRE);
+                if (tag == 0)
+                {
+                    break; // 未发布(或已空)
+                }
+                size_t len = tag - 1;
+                size_t off = (pos + HEADER_SIZE) & _mask;
+                size_t first = std::min(len, _capacity - off);
+                buffer.push(&_ring[off], first);
+                if (first < len)
+                {
+                    buffer.push(&_ring[0], len - first);
+                }
+                // 清零整条记录，保证后续任意位置的记录头初始为0
+                size_t need = RecordSize(len);
+                clear(pos, need);
+                pos += need;
+                bytes += len;
+                count++;
+                _read_pos.store(pos, std::memory_order_release);
+            }
+            return count;
+        }
+        // 是否还有已预留(可能尚未发布)的记录
+        bool empty()
+        {
+            return _write_pos.load(std::memory_order_seq_cst) == _read_pos.load(std::memory_order_acquire);
+        }
+        size_t capacity() { return _capacity; }
+        // 生产者已预留到的位置与消费者已取出到的位置(单调递增)
+        uint64_t writePos() { return _write_pos.load(std::memory_order_seq_cst); }
+        uint64_t readPos() { return _read_pos.load(std::memory_order_relaxed); }
+        // 已预留的字节数(近似值，含记录头)
+        size_t size()
+        {
+            uint64_t read = _read_pos.load(std::memory_order_relaxed);
+            return (size_t)(_write_pos.load(std::memory_order_relaxed) - read);
+        }
+
+    private:
+        static const size_t HEADER_SIZE = 8;
+        static size_t RoundUp(size_t n)
+        {
+            size_t cap = 64;
+            while (cap < n)
+            {
+                cap <<= 1;
+            }
+            return cap;
+        }
+        static size_t RecordSize(size_t len)
+        {
+            return HEADER_SIZE + ((len + 7) & ~(size_t)7);
+        }
+        uint32_t *header(uint64_t pos)
+        {
+            return reinterpret_cast<uint32_t *>(&_ring[pos & _mask]);
+        }
+        void copyIn(uint64_t pos, const char *data, size_t len)
+        {
+            size_t off = pos & _mask;
+            size_t first = std::min(len, _capacity - off);
+            memcpy(&_ring[off], data, first);
+            if (first < len)
+            {
+                memcpy(&_ring[0], data + first, len - first);
+            }
+        }
+        void clear(uint64_t pos, size_t len)
+        {
+            size_t off = pos & _mask;
+            size_t first = std::min(len, _capacity - off);
+            memset(&_ring[off], 0, first);
+            if (first < len)
+            {
+                memset(&_ring[0], 0, len - first);
+            }
+        }
+
+    private:
+        size_t _capacity;
+        size_t _mask;
+        std::vector<char> _ring;
+        std::atomic<uint64_t> _write_pos; // 生产者预留位置
+        char _pad[64];                    // 隔开读写位置，避免伪共享
+        std::atomic<uint64_t> _read_pos;  // 消费者归还位置
+    };
+}
@@ -0,0 +1,352 @@
+#pragma once
+/*日志器自身的运行指标
+    1.生产者路径上的计数器按线程分片(StripedCounter)，每次只是对本线程分片的一次relaxed原子加；
+      被等级过滤的日志(filtered)在最热的路径上，使用按线程的单写者计数(ThreadCounter)，只有本线程计数的一次读与写，没有原子读改写
+    2.落地方向的写入只发生在持锁的同步日志器或异步日志器的工作线程中，使用普通的relaxed原子变量
+    3.延迟按2的幂分桶统计(LatencyHistogram)
+    LoggerManager::stats()返回所有日志器的快照，enableStatsReport可按周期输出一条自报告记录*/
+#include <string>
+#include <vector>
+#include <atomic>
+#include <sstream>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <algorithm>
+#include <time.h>
+
+namespace log_master
+{
+    #define STATS_STRIPES 16 // 分片计数器的分片数
+    #define STATS_BUCKETS 40 // 延迟直方图的桶数(第i个桶为[2^(i-1), 2^i)纳秒)
+    #define STATS_THREAD_COUNTERS 256 // ThreadCounter的个数上限(超过时退化为StripedCounter)
+
+    namespace Stats
+    {
+        // 单调时钟(纳秒)，只用于测量耗时
+        inline uint64_t Now()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        }
+
+        // 按线程分片的计数器：各线程写自己的分片(各占一个缓存行)，读取时求和
+        class StripedCounter
+        {
+        public:
+            StripedCounter()
+            {
+                for (size_t i = 0; i < STATS_STRIPES; i++)
+                {
+                    _slots[i]._value.store(0, std::memory_order_relaxed);
+                }
+            }
+            void add(uint64_t n = 1)
+            {
+                _slots[Slot()]._value.fetch_add(n, std::memory_order_relaxed);
+            }
+            uint64_t load() const
+            {
+                uint64_t sum = 0;
+                for (size_t i = 0; i < STATS_STRIPES; i++)
+                {
+                    sum += _slots[i]._value.load(std::memory_order_relaxed);
+                }
+                return sum;
+            }
+
+        private:
+            static size_t Slot()
+            {
+                static std::atomic<size_t> next(0);
+                static thread_local size_t slot = next++ % STATS_STRIPES;
+                return slot;
+            }
+            struct Padded
+            {
+                std::atomic<uint64_t> _value;
+                char _pad[64 - sizeof(std::atomic<uint64_t>)];
+            };
+            Padded _slots[STATS_STRIPES];
+        };
+
+        // 按线程的单写者计数器：每个线程有一块自己的计数区(所有ThreadCounter共用)，add只是本线程计数的relaxed读与写，
+        //  读取时对所有线程的计数区求和；线程退出后计数区连同已有的计数留给之后的线程复用
+        class ThreadCounter
+        {
+        public:
+            ThreadCounter() : _id(Registry::Instance().acquire()) {}
+            ~ThreadCounter() { Registry::Instance().release(_id); }
+            void add()
+            {
+                if (_id < STATS_THREAD_COUNTERS)
+                {
+                    std::atomic<uint64_t> &v = Local()->_counts[_id];
+                    v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return;
+                }
+                _overflow.add();
+            }
+            uint64_t load() const
+            {
+                return (_id < STATS_THREAD_COUNTERS ? Registry::Instance().sum(_id) : 0) + _overflow.load();
+            }
+
+        private:
+            struct Block
+            {
+                std::atomic<uint64_t> _counts[STATS_THREAD_COUNTERS];
+                bool _used;
+            };
+            class Registry
+            {
+            public:
+                // 不析构：线程退出时仍可能归还计数区
+                static Registry &Instance()
+                {
+                    static Registry *registry = new Registry();
+                    return *registry;
+                }
+                // 分配一个计数器编号，并清零各计数区中该编号的旧计数(新计数器还没有写入者)
+                size_t acquire()
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    for (size_t id = 0; id < STATS_THREAD_COUNTERS; id++)
+                    {
+                        if (!_ids[id])
+                        {
+                            _ids[id] = true;
+                            for (auto b : _blocks)
+                            {
+                                b->_counts[id].store(0, std::memory_order_relaxed);
+                            }
+                            return id;
+                        }
+                    }
+                    return STATS_THREAD_COUNTERS;
+                }
+                void release(size_t id)
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    if (id < STATS_THREAD_COUNTERS)
+                    {
+                        _ids[id] = false;
+                    }
+                }
+                Block *attach()
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    for (auto b : _blocks)
+                    {
+                        if (!b->_used)
+                        {
+                            b->_used = true;
+                            return b;
+                        }
+                    }
+                    Block *b = new Block();
+                    for (size_t i = 0; i < STATS_THREAD_COUNTERS; i++)
+                    {
+                        b->_counts[i].store(0, std::memory_order_relaxed);
+                    }
+                    b->_used = true;
+                    _blocks.push_back(b);
+                    return b;
+                }
+                void detach(Block *b)
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    b->_used = false;
+                }
+                uint64_t sum(size_t id)
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    uint64_t n = 0;
+                    for (auto b : _blocks)
+                    {
+                        n += b->_counts[id].load(std::memory_order_relaxed);
+                    }
+                    return n;
+                }
+
+            private:
+                Registry() : _ids(STATS_THREAD_COUNTERS, false) {}
+                std::mutex _mutex;
+                std::vector<Block *> _blocks;
+                std::vector<bool> _ids;
+            };
+            // 线程退出时归还计数区
+            struct Holder
+            {
+                Block *_block = nullptr;
+                ~Holder()
+                {
+                    if (_block != nullptr)
+                    {
+                        Registry::Instance().detach(_block);
+                    }
+                }
+            };
+            static Block *Local()
+            {
+                static thread_local Block *block = nullptr;
+                if (block == nullptr)
+                {
+                    block = Attach();
+                }
+                return block;
+            }
+            static Block *Attach()
+            {
+                static thread_local Holder holder;
+                holder._block = Registry::Instance().attach();
+                return holder._block;
+            }
+
+            size_t _id;
+            StripedCounter _overflow;
+        };
+
+        // 延迟直方图的快照
+        struct Histogram
+        {
+            uint64_t _count = 0;
+            uint64_t _sum_ns = 0;
+            uint64_t _max_ns = 0;
+            std::vector<uint64_t> _buckets;
+            // 第p百分位所在桶的上界(纳秒)
+            uint64_t percentile(double p) const
+            {
+                if (_count == 0)
+                {
+                    return 0;
+                }
+                uint64_t want = (uint64_t)(_count * p / 100.0);
+                uint64_t seen = 0;
+                for (size_t i = 0; i < _buckets.size(); i++)
+                {
+                    seen += _buckets[i];
+                    if (seen > want)
+                    {
+                        return std::min(_max_ns, (uint64_t)1 << i);
+                    }
+                }
+                return _max_ns;
+            }
+        };
+        // 单写者的延迟直方图(写入方已串行化)，快照可在任意线程读取
+        class LatencyHistogram
+        {
+        public:
+            LatencyHistogram() : _count(0), _sum_ns(0), _max_ns(0)
+            {
+                for (size_t i = 0; i < STATS_BUCKETS; i++)
+                {
+                    _buckets[i].store(0, std::memory_order_relaxed);
+                }
+            }
+            void record(uint64_t ns)
+            {
+                size_t idx = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+                idx = idx < STATS_BUCKETS ? idx : STATS_BUCKETS - 1;
+                _buckets[idx].store(_buckets[idx].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                _count.store(_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                _sum_ns.store(_sum_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+                if (ns > _max_ns.load(std::memory_order_relaxed))
+                {
+                    _max_ns.store(ns, std::memory_order_relaxed);
+                }
+            }
+            Histogram snapshot() const
+            {
+                Histogram h;
+                h._count = _count.load(std::memory_order_relaxed);
+                h._sum_ns = _sum_ns.load(std::memory_order_relaxed);
+                h._max_ns = _max_ns.load(std::memory_order_relaxed);
+                h._buckets.resize(STATS_BUCKETS);
+                for (size_t i = 0; i < STATS_BUCKETS; i++)
+                {
+                    h._buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+                }
+                return h;
+            }
+
+        private:
+            std::atomic<uint64_t> _buckets[STATS_BUCKETS];
+            std::atomic<uint64_t> _count;
+            std::atomic<uint64_t> _sum_ns;
+            std::atomic<uint64_t> _max_ns;
+        };
+    }
+
+    // 落地方向的指标快照
+    struct SinkStats
+    {
+        uint64_t _writes = 0;        // Log调用次数(异步日志器为批次数)
+        uint64_t _bytes = 0;         // 写入的字节数
+        Stats::Histogram _latency;   // 每次Log调用的耗时
+        uint64_t _syncs = 0;         // 刷盘次数
+        uint64_t _sync_ns = 0;       // 刷盘的总耗时
+        uint64_t _unsynced_bytes = 0; // 上次刷盘以来写入的字节数(仅设置了持久化策略时统计)
+        bool _lane = false;          // 是否使用独立的写入通道(以下仅此时有效)
+        uint64_t _lag_bytes = 0;     // 已交给通道但尚未写完的字节数
+        uint64_t _max_lag_bytes = 0; // 积压的峰值
+        uint64_t _skipped_batches = 0; // 因积压超过上限被跳过的批次数
+        uint64_t _skipped_bytes = 0;
+    };
+    // 异步工作器的指标快照
+    struct LooperStats
+    {
+        uint64_t _dropped = 0;     // 被溢出策略丢弃的条数
+        uint64_t _spilled = 0;     // 转存到溢出文件的条数
+        uint64_t _batches = 0;     // 交换缓冲区(交给落地方向)的批次数
+        uint64_t _batch_bytes = 0; // 各批次的总字节数
+        uint64_t _max_batch = 0;   // 最大批次的字节数(生产缓冲区的峰值占用)
+        uint64_t _blocked = 0;     // 生产者因缓冲区满阻塞的次数
+        uint64_t _blocked_ns = 0;  // 生产者阻塞的总时间
+        size_t _fill = 0;          // 快照时生产缓冲区中的字节数
+        size_t _capacity = 0;      // 生产缓冲区容量(非安全模式下可继续扩容)
+    };
+    // 日志器的指标快照
+    struct LoggerStats
+    {
+        std::string _name;
+        bool _async = false;
+        uint64_t _accepted = 0; // 通过等级检查的日志条数
+        uint64_t _filtered = 0; // 因等级不够被过滤的日志条数(含宏的调用点，按线程单写者计数)
+        uint64_t _suppressed = 0; // 被调用点限流/采样拒绝的日志条数
+        LooperStats _looper;    // 仅异步日志器
+        std::vector<SinkStats> _sinks;
+
+        // 单行摘要，用于自报告记录
+        std::string toString() const
+        {
+            std::stringstream ss;
+            ss << "stats " << _name << ": accepted=" << _accepted << " filtered=" << _filtered << " suppressed=" << _suppressed;
+            if (_async)
+            {
+                ss << " dropped=" << _looper._dropped << " spilled=" << _looper._spilled << " batches=" << _looper._batches
+                   << " max_batch=" << _looper._max_batch << " fill=" << _looper._fill << "/" << _looper._capacity
+                   << " blocked=" << _looper._blocked << " blocked_ms=" << _looper._blocked_ns / 1000000;
+            }
+            for (size_t i = 0; i < _sinks.size(); i++)
+            {
+                ss << " sink" << i << "{writes=" << _sinks[i]._writes << " bytes=" << _sinks[i]._bytes
+                   << " p50_ns=" << _sinks[i]._latency.percentile(50) << " p99_ns=" << _sinks[i]._latency.percentile(99)
+                   << " max_ns=" << _sinks[i]._latency._max_ns;
+                if (_sinks[i]._syncs != 0)
+                {
+                    ss << " syncs=" << _sinks[i]._syncs << " sync_avg_ns=" << _sinks[i]._sync_ns / _sinks[i]._syncs << " unsynced=" << _sinks[i]._unsynced_bytes;
+                }
+                if (_sinks[i]._lane)
+                {
+                    ss << " lag=" << _sinks[i]._lag_bytes << " max_lag=" << _sinks[i]._max_lag_bytes
+                       << " skipped=" << _sinks[i]._skipped_batches << "/" << _sinks[i]._skipped_bytes << "B";
+                }
+                ss << "}";
+            }
+            return ss.str();
+        }
+    };
+}
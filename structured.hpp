@@ -0,0 +1,254 @@
+#pragma once
+/*结构化日志：消息之外携带若干有类型的键值对(字段)
+    1.生产者把字段按类型编码为紧凑的字节序列存入LogMsg::_fields，每个字段为
+      [uint8 类型][uint32 键长][键][值]，值:整型/浮点/布尔为8字节，字符串为[uint32 长度][内容]
+    2.JSON/logfmt格式化器(见format.hpp)读取字段后直接写入输出缓冲区，不构造std::stringstream或中间DOM
+    3.字符串转义每次用SSE2检查16字节，整组无需转义时整块复制(无SSE2的平台逐字节检查)
+    用法: logger->info_kv("user login", log_master::kv("user", name), log_master::kv("cost_ms", 12.5));*/
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "./fmtstr.hpp"
+
+namespace log_master
+{
+    namespace Structured
+    {
+        enum FieldTag
+        {
+            FIELD_INT = 1,
+            FIELD_UINT,
+            FIELD_DOUBLE,
+            FIELD_BOOL,
+            FIELD_STR
+        };
+        // 一个键值对，只引用调用表达式中的参数(在同一条日志调用内编码完毕)
+        template <typename T>
+        struct Field
+        {
+            const char *_key;
+            const T &_value;
+        };
+
+        inline void EncodeHead(FmtStr::Writer &w, FieldTag tag, const char *key)
+        {
+            uint8_t t = (uint8_t)tag;
+            uint32_t len = (uint32_t)strlen(key);
+            w.push((char)t);
+            w.append((const char *)&len, sizeof(len));
+            w.append(key, len);
+        }
+        inline void EncodeBits(FmtStr::Writer &w, FieldTag tag, const char *key, uint64_t bits)
+        {
+            EncodeHead(w, tag, key);
+            w.append((const char *)&bits, sizeof(bits));
+        }
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type EncodeField(FmtStr::Writer &w, const char *key, T v)
+        {
+            EncodeBits(w, FIELD_INT, key, (uint64_t)(int64_t)v);
+        }
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type EncodeField(FmtStr::Writer &w, const char *key, T v)
+        {
+            EncodeBits(w, FIELD_UINT, key, (uint64_t)v);
+        }
+        template <typename T>
+        typename std::enable_if<std::is_enum<T>::value>::type EncodeField(FmtStr::Writer &w, const char *key, T v)
+        {
+            EncodeField(w, key, (typename std::underlying_type<T>::type)v);
+        }
+        inline void EncodeField(FmtStr::Writer &w, const char *key, bool v)
+        {
+            EncodeBits(w, FIELD_BOOL, key, v ? 1 : 0);
+        }
+        inline void EncodeField(FmtStr::Writer &w, const char *key, double v)
+        {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            EncodeBits(w, FIELD_DOUBLE, key, bits);
+        }
+        inline void EncodeString(FmtStr::Writer &w, const char *key, const char *s, size_t len)
+        {
+            EncodeHead(w, FIELD_STR, key);
+            uint32_t n = (uint32_t)len;
+            w.append((const char *)&n, sizeof(n));
+            w.append(s, n);
+        }
+        inline void EncodeField(FmtStr::Writer &w, const char *key, const char *s)
+        {
+            if (s == nullptr)
+            {
+                s = "(null)";
+            }
+            EncodeString(w, key, s, strlen(s));
+        }
+        inline void EncodeField(FmtStr::Writer &w, const char *key, const std::string &s)
+        {
+            EncodeString(w, key, s.data(), s.size());
+        }
+
+        inline void EncodeFields(FmtStr::Writer &)
+        {
+        }
+        template <typename T, typename... Rest>
+        void EncodeFields(FmtStr::Writer &w, const Field<T> &f, const Rest &...rest)
+        {
+            EncodeField(w, f._key, f._value);
+            EncodeFields(w, rest...);
+        }
+
+        // 解码后的一个字段(指向编码序列内部)
+        struct FieldView
+        {
+            FieldTag _tag;
+            const char *_key;
+            uint32_t _key_len;
+            uint64_t _bits;   // 整型/浮点/布尔的值
+            const char *_str; // 字符串的值
+            uint32_t _len;
+        };
+        // 顺序读取编码后的字段，遇到截断的数据时结束(字段可能来自磁盘上的二进制日志)
+        class FieldReader
+        {
+        public:
+            FieldReader(const char *data, size_t len) : _pos(data), _end(data + len) {}
+            bool next(FieldView &f)
+            {
+                if (_end - _pos < 5)
+                {
+                    return false;
+                }
+                f._tag = (FieldTag)(uint8_t)_pos[0];
+                memcpy(&f._key_len, _pos + 1, sizeof(f._key_len));
+                if ((size_t)(_end - _pos - 5) < f._key_len)
+                {
+                    return false;
+                }
+                f._key = _pos + 5;
+                const char *p = f._key + f._key_len;
+                if ((size_t)(_end - p) < (f._tag == FIELD_STR ? sizeof(f._len) : sizeof(f._bits)))
+                {
+                    return false;
+                }
+                if (f._tag != FIELD_STR)
+                {
+                    memcpy(&f._bits, p, sizeof(f._bits));
+                    _pos = p + 8;
+                    return true;
+                }
+                memcpy(&f._len, p, sizeof(f._len));
+                if ((size_t)(_end - p - 4) < f._len)
+                {
+                    return false;
+                }
+                f._str = p + 4;
+                _pos = f._str + f._len;
+                return true;
+            }
+
+        private:
+            const char *_pos;
+            const char *_end;
+        };
+
+        inline bool Special(unsigned char c, bool logfmt)
+        {
+            return c < 0x20 || c == '"' || c == '\\' || (logfmt && (c == ' ' || c == '='));
+        }
+        // 返回[p, end)中第一个需要转义的字符：控制字符、'"'、'\\'，logfmt另加空格与'='(决定是否加引号)
+        inline const char *FindSpecial(const char *p, const char *end, bool logfmt)
+        {
+#ifdef __SSE2__
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i slash = _mm_set1_epi8('\\');
+            const __m128i ctl = _mm_set1_epi8(logfmt ? 0x20 : 0x1F); // 无符号比较: max(v, ctl) == ctl 即 v <= ctl
+            const __m128i eq = _mm_set1_epi8(logfmt ? '=' : '"');
+            while (end - p >= 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *)p);
+                __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                                         _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, ctl), ctl), _mm_cmpeq_epi8(v, eq)));
+                int mask = _mm_movemask_epi8(m);
+                if (mask != 0)
+                {
+                    return p + __builtin_ctz(mask);
+                }
+                p += 16;
+            }
+#endif
+            while (p < end && !Special((unsigned char)*p, logfmt))
+            {
+                p++;
+            }
+            return p;
+        }
+        // 按JSON规则转义后追加(不含两侧引号)，非ASCII字节原样输出
+        inline void AppendEscaped(std::string &out, const char *p, size_t len)
+        {
+            static const char hex[] = "0123456789abcdef";
+            const char *end = p + len;
+            while (p < end)
+            {
+                const char *q = FindSpecial(p, end, false);
+                out.append(p, q - p);
+                if (q == end)
+                {
+                    break;
+                }
+                unsigned char c = (unsigned char)*q;
+                switch (c)
+                {
+                case '"':
+                    out.append("\\\"", 2);
+                    break;
+                case '\\':
+                    out.append("\\\\", 2);
+                    break;
+                case '\n':
+                    out.append("\\n", 2);
+                    break;
+                case '\r':
+                    out.append("\\r", 2);
+                    break;
+                case '\t':
+                    out.append("\\t", 2);
+                    break;
+                default:
+                    char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                    out.append(u, sizeof(u));
+                    break;
+                }
+                p = q + 1;
+            }
+        }
+        inline void AppendJsonString(std::string &out, const char *p, size_t len)
+        {
+            out.push_back('"');
+            AppendEscaped(out, p, len);
+            out.push_back('"');
+        }
+        // logfmt的值：含空格、'='、引号、反斜杠或控制字符(以及空串)时加引号并转义，否则原样输出
+        inline void AppendLogfmtValue(std::string &out, const char *p, size_t len)
+        {
+            if (len != 0 && FindSpecial(p, p + len, true) == p + len)
+            {
+                out.append(p, len);
+                return;
+            }
+            AppendJsonString(out, p, len);
+        }
+    }
+
+    // 构造一个结构化字段，如 log_master::kv("user", name)
+    template <typename T>
+    Structured::Field<T> kv(const char *key, const T &value)
+    {
+        return Structured::Field<T>{key, value};
+    }
+}
@@ -0,0 +1,142 @@
+/*堆分配测试：各接口在同步/异步日志器的调用线程上预热后不应再有堆分配
+    替换malloc/calloc/realloc(转发给glibc的实现)，按线程计数；任一组合计数不为0时返回非0
+    负载覆盖短字符串、超过std::string的SSO容量以及超过FmtStr::Writer栈上缓冲区(512字节)的长度*/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "../bitlog.h"
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+static thread_local uint64_t g_allocs = 0;
+extern "C" void *malloc(size_t size)
+{
+    g_allocs++;
+    return __libc_malloc(size);
+}
+extern "C" void *calloc(size_t n, size_t size)
+{
+    g_allocs++;
+    return __libc_calloc(n, size);
+}
+extern "C" void *realloc(void *p, size_t size)
+{
+    g_allocs++;
+    return __libc_realloc(p, size);
+}
+#endif
+
+namespace
+{
+    enum Api
+    {
+        API_PRINTF,
+        API_FMT,
+        API_BIN,
+        API_KV
+    };
+    const char *ApiName(Api api)
+    {
+        const char *names[] = {"printf", "fmt", "bin", "kv"};
+        return names[api];
+    }
+
+    // 空落地方向：只保证文本被写出，测量日志器自身的分配
+    class NullLogSink : public log_master::LogSink
+    {
+    public:
+        void Log(const char *, size_t len) override { _bytes += len; }
+
+    private:
+        size_t _bytes = 0;
+    };
+
+    void Call(log_master::Logger::ptr &logger, Api api, const std::string &payload, int i)
+    {
+        switch (api)
+        {
+        case API_PRINTF:
+            logger->info("%s--%d", payload.c_str(), i);
+            break;
+        case API_FMT:
+            logger->info_fmt("{}--{}", payload.c_str(), i);
+            break;
+        case API_BIN:
+            logger->info_bin("%s--%d", payload.c_str(), i);
+            break;
+        case API_KV:
+            logger->info_kv("login", log_master::kv("user", payload.c_str()), log_master::kv("id", i));
+            break;
+        }
+    }
+
+    log_master::Logger::ptr Build(int mode, const std::string &dir)
+    {
+        std::unique_ptr<log_master::LoggerBuilder> builder(new log_master::LocalLoggerBuilder());
+        builder->buildLoggerName("alloc");
+        builder->buildLoggerLevel(log_master::Log_level::DEBUG);
+        if (mode == 0)
+        {
+            builder->buildLoggerSinks<NullLogSink>();
+        }
+        else
+        {
+            builder->buildLoggerSinks<log_master::FileLogSink>(dir + "alloc-" + std::to_string(mode) + ".log");
+        }
+        if (mode >= 2)
+        {
+            builder->buildLoggerType(log_master::LOGGER_ASYNC);
+        }
+        if (mode == 3)
+        {
+            builder->buildEnableDeferredAsync();
+        }
+        return builder->build();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+#ifndef __GLIBC__
+    printf("skipped: malloc interposition needs glibc\n");
+    return 0;
+#else
+    std::string dir = argc > 1 ? std::string(argv[1]) + "/" : "./";
+    const char *modes[] = {"sync_null", "sync_file", "async_file", "async_deferred"};
+    const Api apis[] = {API_PRINTF, API_FMT, API_BIN, API_KV};
+    const std::string payloads[] = {"INFO", std::string(100, 's'), std::string(2000, 'l')};
+    const int warmup = 1000, calls = 10000;
+    int failed = 0;
+    for (int mode = 0; mode < 4; mode++)
+    {
+        log_master::Logger::ptr logger = Build(mode, dir);
+        for (Api api : apis)
+        {
+            for (auto &payload : payloads)
+            {
+                for (int i = 0; i < warmup; i++)
+                {
+                    Call(logger, api, payload, i);
+                }
+                uint64_t before = g_allocs;
+                for (int i = 0; i < calls; i++)
+                {
+                    Call(logger, api, payload, i);
+                }
+                uint64_t allocs = g_allocs - before;
+                printf("%-15s %-6s payload=%-4zu allocs=%llu\n", modes[mode], ApiName(api), payload.size(), (unsigned long long)allocs);
+                failed += allocs != 0;
+            }
+        }
+        logger.reset();
+        unlink((dir + "alloc-" + std::to_string(mode) + ".log").c_str());
+    }
+    printf(failed ? "FAILED: %d cases allocated on the calling thread\n" : "OK\n", failed);
+    return failed ? 1 : 0;
+#endif
+}
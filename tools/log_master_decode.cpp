@@ -0,0 +1,61 @@
+/*离线解码工具：将BinaryFileLogSink写出的二进制日志还原为文本
+    用法: log_master_decode <二进制日志文件> [格式化规则]
+    格式化规则默认与Formatter相同："[%d{%H:%M:%S}] [%t] [%p] [%c] [%f:%l]%T%m%n"
+*/
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "../binlog.hpp"
+#include "../format.hpp"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <binary log file> [pattern]" << std::endl;
+        return 1;
+    }
+    std::ifstream ifs(argv[1], std::ios::binary);
+    if (!ifs.is_open())
+    {
+        std::cerr << "open " << argv[1] << " failed" << std::endl;
+        return 1;
+    }
+    char magic[8];
+    if (!ifs.read(magic, sizeof(magic)) || memcmp(magic, BINLOG_FILE_MAGIC, sizeof(magic)) != 0)
+    {
+        std::cerr << argv[1] << " is not a log_master binary log" << std::endl;
+        return 1;
+    }
+    log_master::Formatter formatter = argc > 2 ? log_master::Formatter(argv[2]) : log_master::Formatter();
+    log_master::BinLog::Decoder *decoder = nullptr;
+    log_master::BinLog::Decoder dec("", [&decoder](uint32_t id)
+                                    { return decoder->findStored(id); });
+    decoder = &dec;
+
+    // 分块读取，不完整的尾部帧留到下一块
+    std::vector<char> buf(1024 * 1024);
+    size_t used = 0;
+    while (ifs)
+    {
+        ifs.read(&buf[used], buf.size() - used);
+        used += ifs.gcount();
+        size_t consumed = dec.Decode(buf.data(), used, [&formatter](log_master::Message::LogMsg &msg)
+                                     { formatter.Format(std::cout, msg); }, [](const char *data, size_t len)
+                                     { std::cout.write(data, len); });
+        memmove(&buf[0], &buf[consumed], used - consumed);
+        used -= consumed;
+        if (used == buf.size())
+        {
+            buf.resize(buf.size() * 2); // 单帧超过缓冲区大小
+        }
+    }
+    if (used != 0)
+    {
+        std::cerr << "warning: " << used << " bytes of truncated frame ignored" << std::endl;
+    }
+    return 0;
+}
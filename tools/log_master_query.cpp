@@ -0,0 +1,343 @@
+/*时间索引查询工具：按时间范围与等级读取滚动文件(需开启LoggerBuilder::buildSinkIndex)
+    用法: log_master_query <日志文件|滚动文件名前缀>... [--from "YYYY-MM-DD HH:MM:SS"] [--to "YYYY-MM-DD HH:MM:SS"] [--level 等级] [--stat]
+    1.先读各文件的索引(.idx)，时间范围或等级不相交的文件与块直接跳过，只读取命中的块(.log.gz需zlib，按未压缩偏移gzseek)
+    2.输出以索引块为单位(块内可能含有范围之外的记录)；没有索引的部分(索引之前已有的内容、崩溃或仍在写入的文件尾部)总是输出
+    3.--stat只输出各文件的时间范围、各等级条数以及需要读取的字节数
+*/
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef LOG_MASTER_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#include "../logindex.hpp"
+#include "../util.hpp"
+
+using log_master::Log_level;
+namespace LogIndex = log_master::LogIndex;
+
+struct Query
+{
+    uint64_t _from = 0;
+    uint64_t _to = UINT64_MAX;
+    Log_level::level _level = Log_level::UNKNOW;
+    bool _stat = false;
+};
+
+// 一段需要输出的[_begin, _end)(_end为UINT64_MAX时读到文件末尾)
+struct Range
+{
+    uint64_t _begin;
+    uint64_t _end;
+};
+
+static bool ParseTime(const char *s, uint64_t &ns)
+{
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    if (sscanf(s, "%d-%d-%d %d:%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min, &t.tm_sec) < 3)
+    {
+        return false;
+    }
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    t.tm_isdst = -1;
+    time_t sec = mktime(&t);
+    if (sec == (time_t)-1)
+    {
+        return false;
+    }
+    ns = (uint64_t)sec * 1000000000ull;
+    return true;
+}
+
+static bool ParseLevel(const std::string &s, Log_level::level &level)
+{
+    for (int i = Log_level::DEBUG; i <= Log_level::FATAL; i++)
+    {
+        if (s == Log_level::ToCString((Log_level::level)i))
+        {
+            level = (Log_level::level)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::string TimeString(uint64_t ns)
+{
+    if (ns == 0 || ns == UINT64_MAX)
+    {
+        return "-";
+    }
+    time_t sec = (time_t)(ns / 1000000000ull);
+    struct tm t;
+    localtime_r(&sec, &t);
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &t);
+    return buf;
+}
+
+static bool IsLogFile(const std::string &name)
+{
+    auto ends = [&name](const char *suffix)
+    {
+        size_t n = strlen(suffix);
+        return name.size() >= n && name.compare(name.size() - n, n, suffix) == 0;
+    };
+    return ends(".log") || ends(".log.gz");
+}
+
+// 参数为已存在的文件时直接使用，否则作为滚动文件名前缀(与RollByFileLogSink/RollByTimeLogSink的basename相同)匹配目录中的日志文件
+static void Collect(const std::string &arg, std::vector<std::string> &files)
+{
+    struct stat st;
+    if (stat(arg.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+    {
+        files.push_back(arg);
+        return;
+    }
+    std::string dir = log_master::Util::File::Path(arg);
+    size_t pos = arg.find_last_of("/\\");
+    std::string prefix = pos == std::string::npos ? arg : arg.substr(pos + 1);
+    std::string base = pos == std::string::npos ? "" : dir;
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr)
+    {
+        return;
+    }
+    struct dirent *e;
+    while ((e = readdir(d)) != nullptr)
+    {
+        std::string name = e->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0 && IsLogFile(name))
+        {
+            files.push_back(base + name);
+        }
+    }
+    closedir(d);
+}
+
+static bool IsGzip(const std::string &pathname)
+{
+    return pathname.size() > 3 && pathname.compare(pathname.size() - 3, 3, ".gz") == 0;
+}
+
+// 块是否可能含有命中的记录(时间未知、等级未知的记录按命中处理)
+static bool Match(const LogIndex::Entry &e, const Query &q)
+{
+    if (e._records == 0)
+    {
+        return false;
+    }
+    bool timed = e._min_ns != UINT64_MAX;
+    if (timed && (e._max_ns < q._from || e._min_ns > q._to))
+    {
+        return false;
+    }
+    return e._levels[Log_level::UNKNOW] != 0 || e.atLeast(q._level) != 0;
+}
+
+// 由索引计算需要读取的区间(相邻的块合并)
+static void Plan(const std::vector<LogIndex::Entry> &blocks, const Query &q, std::vector<Range> &ranges)
+{
+    auto push = [&ranges](uint64_t begin, uint64_t end)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        if (!ranges.empty() && ranges.back()._end == begin)
+        {
+            ranges.back()._end = end;
+            return;
+        }
+        ranges.push_back(Range{begin, end});
+    };
+    uint64_t pos = 0;
+    for (auto &e : blocks)
+    {
+        push(pos, e._offset); // 没有索引的部分
+        if (Match(e, q))
+        {
+            push(e._offset, e._offset + e._length);
+        }
+        pos = std::max(pos, e._offset + e._length);
+    }
+    ranges.push_back(Range{pos, UINT64_MAX}); // 索引之后的部分(通常为空)
+}
+
+static bool Output(const std::string &pathname, const std::vector<Range> &ranges)
+{
+    std::vector<char> buf(256 * 1024);
+    if (IsGzip(pathname))
+    {
+#ifdef LOG_MASTER_HAS_ZLIB
+        gzFile in = gzopen(pathname.c_str(), "rb");
+        if (in == nullptr)
+        {
+            return false;
+        }
+        for (auto &r : ranges)
+        {
+            if (gzseek(in, (z_off_t)r._begin, SEEK_SET) < 0)
+            {
+                break;
+            }
+            uint64_t left = r._end - r._begin;
+            while (left != 0)
+            {
+                int n = gzread(in, &buf[0], (unsigned)std::min<uint64_t>(left, buf.size()));
+                if (n <= 0)
+                {
+                    break;
+                }
+                fwrite(&buf[0], 1, n, stdout);
+                left -= n;
+            }
+        }
+        gzclose(in);
+        return true;
+#else
+        std::cerr << pathname << ": built without zlib" << std::endl;
+        return false;
+#endif
+    }
+    int fd = ::open(pathname.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    for (auto &r : ranges)
+    {
+        uint64_t pos = r._begin;
+        while (pos < r._end)
+        {
+            ssize_t n = pread(fd, &buf[0], (size_t)std::min<uint64_t>(r._end - pos, buf.size()), (off_t)pos);
+            if (n <= 0)
+            {
+                break;
+            }
+            fwrite(&buf[0], 1, n, stdout);
+            pos += n;
+        }
+    }
+    ::close(fd);
+    return true;
+}
+
+static void Stat(const std::string &pathname, bool has_index, const LogIndex::Entry &file, const std::vector<LogIndex::Entry> &blocks, const Query &q)
+{
+    uint64_t hit = 0, hit_bytes = 0;
+    for (auto &e : blocks)
+    {
+        if (Match(e, q))
+        {
+            hit++;
+            hit_bytes += e._length;
+        }
+    }
+    printf("%s\n", pathname.c_str());
+    if (!has_index)
+    {
+        printf("  no index\n");
+        return;
+    }
+    printf("  time: %s ~ %s  records: %llu\n", TimeString(file._min_ns).c_str(), TimeString(file._max_ns).c_str(), (unsigned long long)file._records);
+    printf("  levels:");
+    for (int i = Log_level::UNKNOW; i <= Log_level::FATAL; i++)
+    {
+        printf(" %s=%u", Log_level::ToCString((Log_level::level)i), file._levels[i]);
+    }
+    printf("\n  blocks: %llu/%zu  bytes: %llu/%llu\n", (unsigned long long)hit, blocks.size(), (unsigned long long)hit_bytes, (unsigned long long)file._length);
+}
+
+int main(int argc, char *argv[])
+{
+    Query q;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool value = i + 1 < argc;
+        if (arg == "--from" && value && ParseTime(argv[i + 1], q._from))
+        {
+            i++;
+        }
+        else if (arg == "--to" && value && ParseTime(argv[i + 1], q._to))
+        {
+            q._to += 999999999ull; // 包含该秒内的记录
+            i++;
+        }
+        else if (arg == "--level" && value && ParseLevel(argv[i + 1], q._level))
+        {
+            i++;
+        }
+        else if (arg == "--stat")
+        {
+            q._stat = true;
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            files.clear();
+            break;
+        }
+        else
+        {
+            Collect(arg, files);
+        }
+    }
+    if (files.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " <log file|basename>... [--from \"YYYY-MM-DD HH:MM:SS\"] [--to \"YYYY-MM-DD HH:MM:SS\"] [--level DEBUG|INFO|WARNING|ERROR|FATAL] [--stat]" << std::endl;
+        return 1;
+    }
+
+    struct File
+    {
+        std::string _pathname;
+        bool _has_index;
+        LogIndex::Entry _summary;
+        std::vector<LogIndex::Entry> _blocks;
+    };
+    std::vector<File> set;
+    for (auto &f : files)
+    {
+        File e;
+        e._pathname = f;
+        e._has_index = LogIndex::Read(f, e._blocks, e._summary);
+        set.push_back(std::move(e));
+    }
+    // 按文件中最早的记录排序(没有索引的文件按文件名排在前面)
+    std::sort(set.begin(), set.end(), [](const File &a, const File &b)
+              {
+                  uint64_t ta = a._has_index ? a._summary._min_ns : 0;
+                  uint64_t tb = b._has_index ? b._summary._min_ns : 0;
+                  return ta != tb ? ta < tb : a._pathname < b._pathname; });
+    int rc = 0;
+    for (auto &f : set)
+    {
+        if (q._stat)
+        {
+            Stat(f._pathname, f._has_index, f._summary, f._blocks, q);
+            continue;
+        }
+        std::vector<Range> ranges;
+        Plan(f._blocks, q, ranges);
+        if (!Output(f._pathname, ranges))
+        {
+            std::cerr << "read " << f._pathname << " failed" << std::endl;
+            rc = 1;
+        }
+    }
+    return rc;
+}
@@ -1,5 +1,5 @@
 
-#include "../log_master/bitlog.h"
+#include "../bitlog.h"
 #include <unistd.h>
 
 void log_test(const std::string &name)
@@ -10,6 +10,8 @@ void log_test(const std::string &name)
     asynclogger->warning("%s--%d", "WARNING", 666);
     asynclogger->error("%s--%d", "ERROR", 666);
     asynclogger->fatal("%s--%d", "FATAL", 666);
+    // {}风格接口，占位符数量在编译期校验
+    asynclogger->info_fmt("{}--{}", "INFO_FMT", 666);
 
     size_t count = 0;
     while (count < 50000)
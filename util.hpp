@@ -1,13 +1,25 @@
 #pragma once
 /*实现实用工具类
-1.获取系统时间
+1.获取系统时间(秒级/纳秒级，可选时钟源)
 2.判断文件是否存在
 3.获取文件所在路径
 4.创建目录
 */
 #include <iostream>
 #include <ctime>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <time.h>
 #include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LOG_MASTER_HAS_TSC 1
+#endif
 
 namespace log_master
 {
@@ -21,6 +33,155 @@ namespace log_master
                 return (size_t)std::time(nullptr);
             }
         };
+        // 纳秒时间戳的时钟源
+        enum ClockSource
+        {
+            CLOCK_SRC_REALTIME, // clock_gettime(CLOCK_REALTIME)，经vDSO，精度纳秒
+            CLOCK_SRC_COARSE,   // clock_gettime(CLOCK_REALTIME_COARSE)，最廉价，精度为时钟节拍(通常1~4ms)
+            CLOCK_SRC_TSC       // rdtsc+后台线程每秒校准，只有x86可用，其他平台退化为CLOCK_SRC_REALTIME
+        };
+        // 基于TSC的时钟：ns = base_ns + (tsc - base_tsc) * mult >> 32
+        // 校准参数由后台线程每秒更新，读取方通过序号(seqlock)保证读到一致的参数；
+        // 校准时以当前外推的时间为新的起点，只调整斜率在下一秒内追上系统时间，相邻两条日志的时间不会回退
+        // (系统时间跳变超过TSC_STEP_NS时直接对齐)
+        #define TSC_STEP_NS 1000000000ull // 与系统时间相差超过该值时直接对齐，不再平滑调整
+        class TscClock
+        {
+        public:
+            static TscClock &getInstance()
+            {
+                static TscClock eton;
+                return eton;
+            }
+            uint64_t now()
+            {
+#ifdef LOG_MASTER_HAS_TSC
+                uint64_t seq, base_tsc, base_ns, mult;
+                do
+                {
+                    seq = _seq.load(std::memory_order_acquire);
+                    base_tsc = _base_tsc.load(std::memory_order_relaxed);
+                    base_ns = _base_ns.load(std::memory_order_relaxed);
+                    mult = _mult.load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                } while ((seq & 1) || seq != _seq.load(std::memory_order_relaxed));
+                uint64_t delta = __rdtsc() - base_tsc;
+                return base_ns + (uint64_t)(((unsigned __int128)delta * mult) >> 32);
+#else
+                return RealTime(CLOCK_REALTIME);
+#endif
+            }
+            ~TscClock()
+            {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _cond.notify_all();
+                if (_thread.joinable())
+                {
+                    _thread.join();
+                }
+            }
+            static uint64_t RealTime(clockid_t id)
+            {
+                struct timespec ts;
+                clock_gettime(id, &ts);
+                return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+            }
+
+        private:
+            TscClock() : _seq(0), _base_tsc(0), _base_ns(0), _mult(0), _stop(false)
+            {
+#ifdef LOG_MASTER_HAS_TSC
+                // 初次校准：用10ms的间隔测出tsc频率
+                uint64_t tsc0 = __rdtsc(), ns0 = RealTime(CLOCK_MONOTONIC_RAW);
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                uint64_t tsc1 = __rdtsc(), ns1 = RealTime(CLOCK_MONOTONIC_RAW);
+                publish(tsc1, RealTime(CLOCK_REALTIME), Mult(ns1 - ns0, tsc1 - tsc0));
+                _thread = std::thread(&TscClock::calibrate, this);
+#endif
+            }
+            void publish(uint64_t base_tsc, uint64_t base_ns, uint64_t mult)
+            {
+                _seq.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                _base_tsc.store(base_tsc, std::memory_order_relaxed);
+                _base_ns.store(base_ns, std::memory_order_relaxed);
+                _mult.store(mult, std::memory_order_relaxed);
+                _seq.fetch_add(1, std::memory_order_release);
+            }
+#ifdef LOG_MASTER_HAS_TSC
+            // ns纳秒对应ticks个tick时每个tick的纳秒数(32位定点小数，128位中间结果，间隔很长时也不溢出)
+            static uint64_t Mult(uint64_t ns, uint64_t ticks)
+            {
+                return (uint64_t)(((unsigned __int128)ns << 32) / ticks);
+            }
+#endif
+            // 后台校准：以系统时间为准修正频率，吸收NTP调整与tsc漂移
+            void calibrate()
+            {
+#ifdef LOG_MASTER_HAS_TSC
+                uint64_t tsc0 = __rdtsc(), ns0 = RealTime(CLOCK_MONOTONIC_RAW);
+                std::unique_lock<std::mutex> lock(_mutex);
+                while (!_cond.wait_for(lock, std::chrono::seconds(1), [this]()
+                                       { return _stop; }))
+                {
+                    uint64_t tsc1 = __rdtsc(), ns1 = RealTime(CLOCK_MONOTONIC_RAW);
+                    uint64_t real = RealTime(CLOCK_REALTIME);
+                    if (tsc1 > tsc0 && ns1 > ns0)
+                    {
+                        // 只有本线程修改参数，直接读取即可
+                        uint64_t base_tsc = _base_tsc.load(std::memory_order_relaxed);
+                        uint64_t cur = _base_ns.load(std::memory_order_relaxed) +
+                                       (uint64_t)(((unsigned __int128)(tsc1 - base_tsc) * _mult.load(std::memory_order_relaxed)) >> 32);
+                        int64_t offset = (int64_t)(real - cur);
+                        uint64_t span = ns1 - ns0; // 上一个间隔的实际长度，作为下一个间隔的预期长度
+                        if (offset > (int64_t)TSC_STEP_NS || offset < -(int64_t)TSC_STEP_NS)
+                        {
+                            publish(tsc1, real, Mult(span, tsc1 - tsc0));
+                        }
+                        else
+                        {
+                            // 下一个间隔内追上offset，斜率限制在0.5~1.5倍之间
+                            int64_t limit = (int64_t)(span / 2);
+                            offset = std::max(-limit, std::min(limit, offset));
+                            publish(tsc1, cur, Mult(span + offset, tsc1 - tsc0));
+                        }
+                    }
+                    tsc0 = tsc1;
+                    ns0 = ns1;
+                }
+#endif
+            }
+
+        private:
+            std::atomic<uint64_t> _seq;
+            std::atomic<uint64_t> _base_tsc;
+            std::atomic<uint64_t> _base_ns;
+            std::atomic<uint64_t> _mult; // 每个tick对应的纳秒数(32位定点小数)
+            bool _stop;
+            std::mutex _mutex;
+            std::condition_variable _cond;
+            std::thread _thread;
+        };
+        class Clock
+        {
+        public:
+            // 返回自1970年以来的纳秒数
+            static uint64_t Now(ClockSource source = CLOCK_SRC_REALTIME)
+            {
+                switch (source)
+                {
+                case CLOCK_SRC_COARSE:
+                    return TscClock::RealTime(CLOCK_REALTIME_COARSE);
+                case CLOCK_SRC_TSC:
+                    return TscClock::getInstance().now();
+                default:
+                    return TscClock::RealTime(CLOCK_REALTIME);
+                }
+            }
+        };
         class File
         {
         public:
@@ -34,6 +195,16 @@ namespace log_master
                 }
                 return true;
             }
+            // 文件大小，文件不存在时为0
+            static size_t Size(const std::string &filepath)
+            {
+                struct stat st;
+                if (stat(filepath.c_str(), &st) < 0)
+                {
+                    return 0;
+                }
+                return st.st_size;
+            }
             //
             static std::string Path(const std::string &pathname)
             {